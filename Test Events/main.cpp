@@ -23,15 +23,50 @@
 
 #include <SFML/Graphics.hpp>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <charconv>
+#include <cerrno>
+#include <chrono>
 #include <clocale>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <deque>
+#include <fstream>
 #include <functional>
+#include <future>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <map>
-#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <random>
+#include <set>
 #include <sstream>
+#include <limits>
+#include <string_view>
+#include <thread>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
 
 #ifdef SFML_SYSTEM_MACOS
 #include "ResourcePath.hpp"
@@ -39,682 +74,5962 @@
 std::string resourcePath() { return ""; }
 #endif
 
-std::string key2string(sf::Keyboard::Key key)
+// Count heap allocations so that benchmarks can report them. The global
+// operator new is only replaced in benchmark builds (-DCOUNT_ALLOCATIONS).
+namespace
 {
-// Code based on lib Thor
-#define CASE(id)                                                                                   \
-    case sf::Keyboard::id:                                                                         \
-        return #id
+    std::atomic<std::uint64_t> allocationCount{ 0 };
 
-    switch (key)
-    {
-    default:
-        CASE(Unknown);
-
-        CASE(A);
-        CASE(B);
-        CASE(C);
-        CASE(D);
-        CASE(E);
-        CASE(F);
-        CASE(G);
-        CASE(H);
-        CASE(I);
-        CASE(J);
-        CASE(K);
-        CASE(L);
-        CASE(M);
-        CASE(N);
-        CASE(O);
-        CASE(P);
-        CASE(Q);
-        CASE(R);
-        CASE(S);
-        CASE(T);
-        CASE(U);
-        CASE(V);
-        CASE(W);
-        CASE(X);
-        CASE(Y);
-        CASE(Z);
-        CASE(Num0);
-        CASE(Num1);
-        CASE(Num2);
-        CASE(Num3);
-        CASE(Num4);
-        CASE(Num5);
-        CASE(Num6);
-        CASE(Num7);
-        CASE(Num8);
-        CASE(Num9);
-        CASE(Escape);
-        CASE(LControl);
-        CASE(LShift);
-        CASE(LAlt);
-        CASE(LSystem);
-        CASE(RControl);
-        CASE(RShift);
-        CASE(RAlt);
-        CASE(RSystem);
-        CASE(Menu);
-        CASE(LBracket);
-        CASE(RBracket);
-        CASE(SemiColon);
-        CASE(Comma);
-        CASE(Period);
-        CASE(Quote);
-        CASE(Slash);
-        CASE(BackSlash);
-        CASE(Tilde);
-        CASE(Equal);
-        CASE(Dash);
-        CASE(Space);
-        CASE(Return);
-        CASE(BackSpace);
-        CASE(Tab);
-        CASE(PageUp);
-        CASE(PageDown);
-        CASE(End);
-        CASE(Home);
-        CASE(Insert);
-        CASE(Delete);
-        CASE(Add);
-        CASE(Subtract);
-        CASE(Multiply);
-        CASE(Divide);
-        CASE(Left);
-        CASE(Right);
-        CASE(Up);
-        CASE(Down);
-        CASE(Numpad0);
-        CASE(Numpad1);
-        CASE(Numpad2);
-        CASE(Numpad3);
-        CASE(Numpad4);
-        CASE(Numpad5);
-        CASE(Numpad6);
-        CASE(Numpad7);
-        CASE(Numpad8);
-        CASE(Numpad9);
-        CASE(F1);
-        CASE(F2);
-        CASE(F3);
-        CASE(F4);
-        CASE(F5);
-        CASE(F6);
-        CASE(F7);
-        CASE(F8);
-        CASE(F9);
-        CASE(F10);
-        CASE(F11);
-        CASE(F12);
-        CASE(F13);
-        CASE(F14);
-        CASE(F15);
-        CASE(Pause);
-    }
-
-    static_assert(sf::Keyboard::KeyCount == 101, "Number of SFML keys has changed");
-
-#undef CASE
-}
-
-
-std::string button2string(sf::Mouse::Button button)
-{
-#define CASE(id)                                                                                   \
-    case sf::Mouse::id:                                                                            \
-        return #id
-
-    switch (button)
+#ifdef COUNT_ALLOCATIONS
+    bool constexpr countsAllocations = true;
+#else
+    bool constexpr countsAllocations = false;
+#endif
+
+    // "<n> allocations/<unit>" for the benchmark reports
+    std::string allocationRate(std::uint64_t allocations, double units, char const* unit)
     {
-    default:
-        CASE(ButtonCount);
-        CASE(Left);
-        CASE(Right);
-        CASE(Middle);
-        CASE(XButton1);
-        CASE(XButton2);
-    }
+        if (!countsAllocations)
+            return "allocations not counted";
 
-    static_assert(sf::Mouse::ButtonCount == 5, "Number of SFML mouse buttons has changed");
+        std::ostringstream rate;
+        rate << allocations / std::max(units, 1.0) << " allocations/" << unit;
+        return rate.str();
+    }
+}
 
-#undef CASE
+#ifdef COUNT_ALLOCATIONS
+void* operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size))
+        return ptr;
+    throw std::bad_alloc();
 }
 
+// Not inlined: GCC would otherwise pair the free() with the new expression and
+// warn about mismatched allocation functions
+[[gnu::noinline]] void operator delete(void* ptr) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+#endif
+
+// Names of enumeration values, in the order of the values so that lookups
+// are a simple indexing; reverse lookups are linear searches.
+template <class Enum>
+struct EnumName
+{
+    Enum value;
+    std::string_view name;
+};
 
-std::string axis2string(sf::Joystick::Axis axis)
+template <class Enum, std::size_t N>
+constexpr bool isIndexedByValue(EnumName<Enum> const (&names)[N])
 {
-#define CASE(id)                                                                                   \
-    case sf::Joystick::id:                                                                         \
-        return #id
+    for (std::size_t i = 0; i < N; ++i)
+        if (static_cast<std::size_t>(names[i].value) != i)
+            return false;
+    return true;
+}
 
-    switch (axis)
-    {
-        CASE(X);
-        CASE(Y);
-        CASE(Z);
-        CASE(R);
-        CASE(U);
-        CASE(V);
-        CASE(PovX);
-        CASE(PovY);
-    }
+template <class Enum, std::size_t N>
+constexpr std::string_view nameOf(EnumName<Enum> const (&names)[N], Enum value, std::string_view fallback)
+{
+    auto const index = static_cast<std::size_t>(value);
+    return index < N ? names[index].name : fallback;
+}
 
-#undef CASE
+template <class Enum, std::size_t N>
+std::optional<Enum> valueOf(EnumName<Enum> const (&names)[N], std::string_view name)
+{
+    for (auto const& entry : names)
+        if (entry.name == name)
+            return entry.value;
+    return std::nullopt;
 }
 
+// Code based on lib Thor
+#define KEY(id) EnumName<sf::Keyboard::Key>{ sf::Keyboard::id, #id }
+constexpr EnumName<sf::Keyboard::Key> keyNames[] = {
+    KEY(A), KEY(B), KEY(C), KEY(D), KEY(E), KEY(F),
+    KEY(G), KEY(H), KEY(I), KEY(J), KEY(K), KEY(L),
+    KEY(M), KEY(N), KEY(O), KEY(P), KEY(Q), KEY(R),
+    KEY(S), KEY(T), KEY(U), KEY(V), KEY(W), KEY(X),
+    KEY(Y), KEY(Z), KEY(Num0), KEY(Num1), KEY(Num2), KEY(Num3),
+    KEY(Num4), KEY(Num5), KEY(Num6), KEY(Num7), KEY(Num8), KEY(Num9),
+    KEY(Escape), KEY(LControl), KEY(LShift), KEY(LAlt), KEY(LSystem), KEY(RControl),
+    KEY(RShift), KEY(RAlt), KEY(RSystem), KEY(Menu), KEY(LBracket), KEY(RBracket),
+    KEY(SemiColon), KEY(Comma), KEY(Period), KEY(Quote), KEY(Slash), KEY(BackSlash),
+    KEY(Tilde), KEY(Equal), KEY(Dash), KEY(Space), KEY(Return), KEY(BackSpace),
+    KEY(Tab), KEY(PageUp), KEY(PageDown), KEY(End), KEY(Home), KEY(Insert),
+    KEY(Delete), KEY(Add), KEY(Subtract), KEY(Multiply), KEY(Divide), KEY(Left),
+    KEY(Right), KEY(Up), KEY(Down), KEY(Numpad0), KEY(Numpad1), KEY(Numpad2),
+    KEY(Numpad3), KEY(Numpad4), KEY(Numpad5), KEY(Numpad6), KEY(Numpad7), KEY(Numpad8),
+    KEY(Numpad9), KEY(F1), KEY(F2), KEY(F3), KEY(F4), KEY(F5),
+    KEY(F6), KEY(F7), KEY(F8), KEY(F9), KEY(F10), KEY(F11),
+    KEY(F12), KEY(F13), KEY(F14), KEY(F15), KEY(Pause),
+};
+#undef KEY
 
+static_assert(std::size(keyNames) == sf::Keyboard::KeyCount, "Number of SFML keys has changed");
+static_assert(isIndexedByValue(keyNames), "keyNames is not in the order of sf::Keyboard::Key");
 
-class GraphicLogger : public sf::Drawable, public sf::Transformable
+#define BUTTON(id) EnumName<sf::Mouse::Button>{ sf::Mouse::id, #id }
+constexpr EnumName<sf::Mouse::Button> buttonNames[] = {
+    BUTTON(Left), BUTTON(Right), BUTTON(Middle), BUTTON(XButton1), BUTTON(XButton2),
+};
+#undef BUTTON
+
+static_assert(std::size(buttonNames) == sf::Mouse::ButtonCount, "Number of SFML mouse buttons has changed");
+static_assert(isIndexedByValue(buttonNames), "buttonNames is not in the order of sf::Mouse::Button");
+
+#define AXIS(id) EnumName<sf::Joystick::Axis>{ sf::Joystick::id, #id }
+constexpr EnumName<sf::Joystick::Axis> axisNames[] = {
+    AXIS(X), AXIS(Y), AXIS(Z), AXIS(R), AXIS(U), AXIS(V), AXIS(PovX), AXIS(PovY),
+};
+#undef AXIS
+
+static_assert(std::size(axisNames) == sf::Joystick::AxisCount, "Number of SFML joystick axes has changed");
+static_assert(isIndexedByValue(axisNames), "axisNames is not in the order of sf::Joystick::Axis");
+
+#define EVENT(id) EnumName<sf::Event::EventType>{ sf::Event::id, #id }
+constexpr EnumName<sf::Event::EventType> eventTypeNames[] = {
+    EVENT(Closed), EVENT(Resized), EVENT(LostFocus), EVENT(GainedFocus), EVENT(TextEntered),
+    EVENT(KeyPressed), EVENT(KeyReleased), EVENT(MouseWheelMoved), EVENT(MouseWheelScrolled),
+    EVENT(MouseButtonPressed), EVENT(MouseButtonReleased), EVENT(MouseMoved), EVENT(MouseEntered),
+    EVENT(MouseLeft), EVENT(JoystickButtonPressed), EVENT(JoystickButtonReleased), EVENT(JoystickMoved),
+    EVENT(JoystickConnected), EVENT(JoystickDisconnected), EVENT(TouchBegan), EVENT(TouchMoved),
+    EVENT(TouchEnded), EVENT(SensorChanged),
+};
+#undef EVENT
+
+static_assert(std::size(eventTypeNames) == sf::Event::Count, "Number of SFML event types has changed");
+static_assert(isIndexedByValue(eventTypeNames), "eventTypeNames is not in the order of sf::Event::EventType");
+
+constexpr std::string_view key2string(sf::Keyboard::Key key) { return nameOf(keyNames, key, "Unknown"); }
+constexpr std::string_view button2string(sf::Mouse::Button button) { return nameOf(buttonNames, button, "ButtonCount"); }
+constexpr std::string_view axis2string(sf::Joystick::Axis axis) { return nameOf(axisNames, axis, "Unknown"); }
+constexpr std::string_view eventType2string(sf::Event::EventType type) { return nameOf(eventTypeNames, type, "Count"); }
+
+std::optional<sf::Keyboard::Key> string2key(std::string_view name) { return valueOf(keyNames, name); }
+std::optional<sf::Mouse::Button> string2button(std::string_view name) { return valueOf(buttonNames, name); }
+std::optional<sf::Joystick::Axis> string2axis(std::string_view name) { return valueOf(axisNames, name); }
+std::optional<sf::Event::EventType> string2eventType(std::string_view name) { return valueOf(eventTypeNames, name); }
+
+
+
+// Append the glyph quads of `str` to `vertices`, laid out exactly like sf::Text
+// does (baseline at `size`, same padding, kerning and whitespace rules) with
+// `origin` as the top-left corner. `str` is any sequence of code points, or of
+// ASCII characters. `prevChar` is used for the kerning of the first character.
+// Returns the pen position once the string is laid out.
+template <class String>
+sf::Vector2f appendText(std::vector<sf::Vertex>& vertices, sf::Font const& font, unsigned int size,
+                        String const& str, sf::Color color, sf::Vector2f origin,
+                        sf::Uint32 prevChar = 0)
 {
-public:
-    GraphicLogger(sf::Font const& font, unsigned int fontSize, unsigned int nbLines)
-        : logs(nbLines)
-        , lines(nbLines)
+    float const whitespace = font.getGlyph(L' ', size, false).advance;
+    float const lineSpacing = font.getLineSpacing(size);
+    float const padding = 1.f;
+
+    float x = origin.x;
+    float y = origin.y + size;
+    for (auto const ch : str)
     {
-        for (unsigned int i = 0; i < lines.size(); ++i)
+        auto const c = static_cast<sf::Uint32>(static_cast<std::make_unsigned_t<decltype(ch)>>(ch));
+
+        // Skipped like sf::Text does, e.g. in CRLF line ends of pasted text
+        if (c == L'\r')
+            continue;
+
+        x += font.getKerning(prevChar, c, size);
+        prevChar = c;
+
+        if (c == L' ' || c == L'\t' || c == L'\n')
         {
-            auto& line = lines[i];
-            // Set up each line
-            line.setFont(font);
-            line.setCharacterSize(fontSize);
-            line.setFillColor(sf::Color::White);
-            line.setPosition(0, i * (fontSize * 1.1));
+            switch (c)
+            {
+            case L' ':  x += whitespace;     break;
+            case L'\t': x += whitespace * 4; break;
+            case L'\n': y += lineSpacing; x = origin.x; break;
+            }
+            continue;
         }
 
-        updateLines();
+        sf::Glyph const& glyph = font.getGlyph(c, size, false);
+
+        float const left   = x + glyph.bounds.left - padding;
+        float const top    = y + glyph.bounds.top - padding;
+        float const right  = x + glyph.bounds.left + glyph.bounds.width + padding;
+        float const bottom = y + glyph.bounds.top + glyph.bounds.height + padding;
+
+        float const u1 = glyph.textureRect.left - padding;
+        float const v1 = glyph.textureRect.top - padding;
+        float const u2 = glyph.textureRect.left + glyph.textureRect.width + padding;
+        float const v2 = glyph.textureRect.top + glyph.textureRect.height + padding;
+
+        vertices.emplace_back(sf::Vector2f(left, top), color, sf::Vector2f(u1, v1));
+        vertices.emplace_back(sf::Vector2f(right, top), color, sf::Vector2f(u2, v1));
+        vertices.emplace_back(sf::Vector2f(left, bottom), color, sf::Vector2f(u1, v2));
+        vertices.emplace_back(sf::Vector2f(left, bottom), color, sf::Vector2f(u1, v2));
+        vertices.emplace_back(sf::Vector2f(right, top), color, sf::Vector2f(u2, v1));
+        vertices.emplace_back(sf::Vector2f(right, bottom), color, sf::Vector2f(u2, v2));
+
+        x += glyph.advance;
     }
 
-    void log(sf::String const& msg)
-    {
-        // pop back and push front
-        logs.pop_back();
-        logs.push_front(msg);
+    return { x, y - size };
+}
 
-        std::cout << "Log: " << msg.toUtf8().c_str() << std::endl;
+// Glyph quads of several text sources, drawn with one call per font texture
+// (SFML keeps one per character size) instead of one call per source. Quads
+// are drawn in the order of their texture's first use, then of their append.
+class TextBatch : public sf::Drawable
+{
+public:
+    // The layers are emptied but keep their memory
+    void clear()
+    {
+        for (auto& layer : layers)
+            layer.vertices.clear();
+    }
 
-        updateLines();
+    // Quads appended to the returned vector are drawn with `texture`
+    std::vector<sf::Vertex>& layer(sf::Texture const& texture)
+    {
+        for (auto& layer : layers)
+            if (layer.texture == &texture)
+                return layer.vertices;
+        layers.push_back({ &texture, {} });
+        return layers.back().vertices;
     }
 
-    void draw(sf::RenderTarget& target, sf::RenderStates states) const override
+    void append(sf::Texture const& texture, sf::VertexArray const& vertices, sf::Transform const& transform)
     {
-        states.transform *= getTransform();
-        for (auto const& line : lines)
+        auto& quads = layer(texture);
+        for (std::size_t i = 0; i < vertices.getVertexCount(); ++i)
         {
-            target.draw(line, states);
+            auto vertex = vertices[i];
+            vertex.position = transform.transformPoint(vertex.position);
+            quads.push_back(vertex);
         }
     }
 
-private:
-    void updateLines()
+    // Number of calls draw() makes
+    std::size_t drawCalls() const
+    {
+        return std::count_if(layers.begin(), layers.end(), [](Layer const& layer) { return !layer.vertices.empty(); });
+    }
+
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override
     {
-        assert(logs.size() == lines.size());
-        for (unsigned int i = 0; i < logs.size(); ++i)
+        for (auto const& layer : layers)
         {
-            sf::String const str = sf::String(std::to_string(i)) + ": " + logs[i];
-            lines[i].setString(str);
+            if (layer.vertices.empty())
+                continue;
+            states.texture = layer.texture;
+            target.draw(layer.vertices.data(), layer.vertices.size(), sf::Triangles, states);
         }
     }
 
 private:
-    std::deque<sf::String> logs;
-    std::vector<sf::Text> lines;
+    struct Layer
+    {
+        sf::Texture const* texture;
+        std::vector<sf::Vertex> vertices;
+    };
+
+    std::vector<Layer> layers;
 };
 
 
 
+// A log entry kept as typed fields; its text is only produced when it is
+// drawn or written out, by formatRecord(). `label` must be a string literal or
+// otherwise outlive the record. Arbitrary text (e.g. the clipboard) is stored
+// next to the record by whoever keeps it, with kind String.
+struct LogRecord
+{
+    enum Kind : std::uint8_t
+    {
+        Text,       // label
+        Pair,       // label: (a; b)
+        Key,        // key a was pressed (b != 0) / released
+        Button,     // button a was pressed (b != 0) / released
+        IntDelta,   // label: delta = a
+        FloatDelta, // label: delta = value
+        Integer,    // label + a
+        Float,      // label + value
+        Axis,       // label + name of axis a
+        CodePoint,  // label + code point a, as U+XXXX
+        String,     // text stored separately
+    };
+
+    Kind kind = Text;
+    char const* label = "";
+    int a = 0;
+    int b = 0;
+    float value = 0;
+    sf::Time timestamp; // set by the logger
+
+    static LogRecord make(Kind kind, char const* label, int a = 0, int b = 0, float value = 0)
+    {
+        LogRecord record;
+        record.kind = kind;
+        record.label = label;
+        record.a = a;
+        record.b = b;
+        record.value = value;
+        return record;
+    }
+
+    static LogRecord text(char const* label) { return make(Text, label); }
+    static LogRecord pair(char const* label, int a, int b) { return make(Pair, label, a, b); }
+    static LogRecord key(sf::Keyboard::Key key, bool pressed) { return make(Key, "", key, pressed); }
+    static LogRecord button(sf::Mouse::Button button, bool pressed) { return make(Button, "", button, pressed); }
+    static LogRecord delta(char const* label, int delta) { return make(IntDelta, label, delta); }
+    static LogRecord delta(char const* label, float delta) { return make(FloatDelta, label, 0, 0, delta); }
+    static LogRecord integer(char const* label, int a) { return make(Integer, label, a); }
+    static LogRecord real(char const* label, float value) { return make(Float, label, 0, 0, value); }
+    static LogRecord axis(char const* label, sf::Joystick::Axis axis) { return make(Axis, label, axis); }
+    static LogRecord codePoint(char const* label, sf::Uint32 c) { return make(CodePoint, label, static_cast<int>(c)); }
+};
 
-class JoystickTable : public sf::Drawable, public sf::Transformable
+// Write the text of `record` into [first, last), truncating it if needed, and
+// return the end of the text. Nothing is allocated.
+char* formatRecord(LogRecord const& record, char* first, char* last)
+{
+    auto append = [&](std::string_view str) {
+        auto const n = std::min<std::size_t>(str.size(), last - first);
+        first = std::copy_n(str.data(), n, first);
+    };
+    auto appendInt = [&](int value) {
+        first = std::to_chars(first, last, value).ptr;
+    };
+    // Same output as std::to_string(float); floating point std::to_chars is
+    // not available with the macOS deployment target
+    auto appendFloat = [&](float value) {
+        char buffer[64];
+        auto const n = std::snprintf(buffer, sizeof(buffer), "%f", value);
+        if (n > 0)
+            append(std::string_view(buffer, std::min<std::size_t>(n, sizeof(buffer) - 1)));
+    };
+
+    switch (record.kind)
+    {
+    case LogRecord::Text:
+    case LogRecord::String:
+        append(record.label);
+        break;
+
+    case LogRecord::Pair:
+        append(record.label);
+        append(": (");
+        appendInt(record.a);
+        append("; ");
+        appendInt(record.b);
+        append(")");
+        break;
+
+    case LogRecord::Key:
+        append(key2string(static_cast<sf::Keyboard::Key>(record.a)));
+        append(record.b ? " was pressed" : " was released");
+        break;
+
+    case LogRecord::Button:
+        append(button2string(static_cast<sf::Mouse::Button>(record.a)));
+        append(record.b ? " was pressed" : " was released");
+        break;
+
+    case LogRecord::IntDelta:
+        append(record.label);
+        append(": delta = ");
+        appendInt(record.a);
+        break;
+
+    case LogRecord::FloatDelta:
+        append(record.label);
+        append(": delta = ");
+        appendFloat(record.value);
+        break;
+
+    case LogRecord::Integer:
+        append(record.label);
+        appendInt(record.a);
+        break;
+
+    case LogRecord::Float:
+        append(record.label);
+        appendFloat(record.value);
+        break;
+
+    case LogRecord::Axis:
+        append(record.label);
+        append(axis2string(static_cast<sf::Joystick::Axis>(record.a)));
+        break;
+
+    case LogRecord::CodePoint:
+    {
+        char digits[16];
+        std::snprintf(digits, sizeof(digits), "U+%04X", static_cast<unsigned int>(record.a));
+        append(record.label);
+        append(digits);
+        break;
+    }
+    }
+
+    return first;
+}
+
+
+
+// Lock-free single-producer single-consumer queue with a fixed capacity
+// (rounded up to a power of two).
+template <class T>
+class SpscQueue
 {
 public:
-    JoystickTable(sf::Font const& font, unsigned int fontSize)
-    : font(font), fontSize(fontSize)
+    explicit SpscQueue(std::size_t capacity)
     {
-        update();
+        std::size_t size = 1;
+        while (size < capacity)
+            size *= 2;
+        slots.resize(size);
     }
 
-    void update()
+    // Producer side; returns false if the queue is full
+    bool push(T&& value)
     {
-        std::function<float(sf::Joystick::Axis)> producer;
-        if (activeJoystickId == -1)
-            producer = [](sf::Joystick::Axis) -> float {
-                return std::numeric_limits<float>::quiet_NaN();
-            };
-        else
-            producer = [id = activeJoystickId](sf::Joystick::Axis axis) -> float {
-                return sf::Joystick::getAxisPosition(id, axis);
-            };
+        auto const tail = writeIndex.load(std::memory_order_relaxed);
+        if (tail - readIndex.load(std::memory_order_acquire) == slots.size())
+            return false;
 
-        generateTable(producer);
+        slots[tail & (slots.size() - 1)] = std::move(value);
+        writeIndex.store(tail + 1, std::memory_order_release);
+        return true;
     }
 
-    void draw(sf::RenderTarget& target, sf::RenderStates states) const override
+    // Consumer side; returns false if the queue is empty
+    bool pop(T& value)
     {
-        states.transform *= getTransform();
-        for (auto const& line : strings)
-            target.draw(line, states);
-    }
+        auto const head = readIndex.load(std::memory_order_relaxed);
+        if (head == writeIndex.load(std::memory_order_acquire))
+            return false;
 
-    void setJoystick(unsigned int idx) { activeJoystickId = idx; }
+        value = std::move(slots[head & (slots.size() - 1)]);
+        readIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
 
-private:
-    sf::Text generateText(sf::Joystick::Axis axis, int y, float value) const
+    std::size_t size() const
     {
-        sf::Text text;
+        return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire);
+    }
 
-        text.setFont(font);
-        text.setCharacterSize(fontSize);
-        text.setFillColor(sf::Color::White);
+    std::size_t capacity() const { return slots.size(); }
 
-        text.setPosition(0, y);
+private:
+    // The indices are kept on separate cache lines by padding rather than
+    // alignas(64): heap allocating over-aligned types needs macOS 10.13.
+    std::vector<T> slots;
+    std::atomic<std::size_t> readIndex{ 0 };
+    [[maybe_unused]] char readPadding[64];
+    std::atomic<std::size_t> writeIndex{ 0 };
+    [[maybe_unused]] char writePadding[64];
+};
 
-        std::stringstream ss;
-        ss << axis2string(axis) << ": " << std::fixed << std::setprecision(3) << value;
-        text.setString(ss.str());
 
-        return text;
+
+// Lock-free bounded multi-producer single-consumer queue (Vyukov's design,
+// with a single consumer): each slot has a sequence number telling whether it
+// is ready to be written or read for a given lap.
+template <class T>
+class MpscQueue
+{
+public:
+    explicit MpscQueue(std::size_t capacity)
+    {
+        std::size_t size = 1;
+        while (size < capacity)
+            size *= 2;
+
+        slots = std::make_unique<Slot[]>(size);
+        mask = size - 1;
+        for (std::size_t i = 0; i < size; ++i)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
     }
 
-    void generateTable(std::function<float(sf::Joystick::Axis)> producer)
+    // Any thread; returns false if the queue is full
+    bool push(T&& value)
     {
-        strings.clear();
+        auto position = writeIndex.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto& slot = slots[position & mask];
+            auto const sequence = slot.sequence.load(std::memory_order_acquire);
+            auto const lap = static_cast<std::ptrdiff_t>(sequence - position);
 
-        // Insert titles + values
-        auto const STEP = fontSize + 3;
-        for (int i = 0; i < sf::Joystick::AxisCount; ++i) {
-            auto axis = static_cast<sf::Joystick::Axis>(i);
-            auto y = i * STEP;
-            strings.push_back(generateText(axis, y, producer(axis)));
+            if (lap == 0)
+            {
+                if (writeIndex.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    slot.value = std::move(value);
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (lap < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = writeIndex.load(std::memory_order_relaxed);
+            }
         }
     }
 
+    // Consumer thread only; returns false if the queue is empty
+    bool pop(T& value)
+    {
+        auto const position = readIndex.load(std::memory_order_relaxed);
+        auto& slot = slots[position & mask];
+        if (slot.sequence.load(std::memory_order_acquire) != position + 1)
+            return false;
+
+        value = std::move(slot.value);
+        slot.sequence.store(position + mask + 1, std::memory_order_release);
+        readIndex.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when producers are running
+    std::size_t size() const
+    {
+        return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire);
+    }
+
 private:
-    std::vector<sf::Text> strings;
-    unsigned int activeJoystickId = -1;
-    sf::Font const& font;
-    unsigned int fontSize;
+    struct Slot
+    {
+        std::atomic<std::size_t> sequence{ 0 };
+        T value;
+    };
+
+    // Padded rather than aligned, like the indices of SpscQueue
+    std::unique_ptr<Slot[]> slots;
+    std::size_t mask = 0;
+    std::atomic<std::size_t> readIndex{ 0 };
+    [[maybe_unused]] char readPadding[64];
+    std::atomic<std::size_t> writeIndex{ 0 };
+    [[maybe_unused]] char writePadding[64];
 };
 
 
 
+// Lock-free exchange of the latest value from one writer to one reader. Each
+// side owns a buffer and they trade the third one: the writer never waits for
+// the reader and the reader always gets a complete value, if not the newest.
 template <class T>
-std::ostream& operator<<(std::ostream& out, sf::Vector2<T> const& v)
+class TripleBuffer
 {
-    return out << "(" << v.x << "; " << v.y << ")";
-}
-
+public:
+    // Writer side: fill back() then publish it
+    T& back() { return buffers[backIndex]; }
 
+    void publish() { backIndex = middle.exchange(backIndex | fresh, std::memory_order_acq_rel) & indexMask; }
 
-namespace
-{
-    int windowCount = 0;
-    bool grabbed = false;
-}
+    // Reader side: take the last value published, if any since the last call
+    bool update()
+    {
+        if ((middle.load(std::memory_order_relaxed) & fresh) == 0)
+            return false;
+        frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
 
+    T const& front() const { return buffers[frontIndex]; }
 
+private:
+    static constexpr unsigned int indexMask = 3;
+    static constexpr unsigned int fresh = 4; // set while the middle buffer was not read
+
+    // Writer, shared and reader indices on separate cache lines, padded rather
+    // than over-aligned so that owners can be heap allocated before macOS 10.13
+    std::array<T, 3> buffers{};
+    unsigned int backIndex = 0;
+    [[maybe_unused]] char backPadding[64];
+    std::atomic<unsigned int> middle{ 1 };
+    [[maybe_unused]] char middlePadding[64];
+    unsigned int frontIndex = 2;
+    [[maybe_unused]] char frontPadding[64];
+};
 
-void drawWindowCount(sf::RenderWindow& window, sf::Font const& font)
-{
-    sf::Text text;
-    text.setString(std::to_string(windowCount));
-    text.setFont(font);
-    text.setCharacterSize(30);
-    text.setFillColor(sf::Color::Yellow);
-    auto pos = window.getSize() / 2u;
-    text.setPosition(static_cast<sf::Vector2f>(pos));
 
-    window.draw(text);
-}
 
-void createWindow(sf::Window& window, sf::VideoMode const& mode, sf::Uint32 style)
+// Write log lines to stdout from a background thread so the render thread
+// never blocks on the terminal or a pipe. Records are formatted by that thread
+// and lines are batched into large writes.
+class StdoutSink
 {
-    ++windowCount;
-    grabbed = false;
+public:
+    enum class Overflow
+    {
+        Drop,  // discard the line and count it
+        Block, // wait for the writer to make room
+    };
 
-    window.create(mode, "SFML Window", style);
-    window.setFramerateLimit(30);
+    struct Policy
+    {
+        sf::Time interval = sf::milliseconds(100); // flush at least this often
+        std::size_t flushSize = 64 * 1024;         // flush as soon as that many bytes are pending
+        std::size_t capacity = 4096;               // number of queued lines
+        Overflow overflow = Overflow::Drop;
+    };
+
+    explicit StdoutSink(Policy const& policy)
+        : policy(policy)
+        , queue(policy.capacity)
+        , writer(&StdoutSink::run, this)
+    {
+    }
 
-    std::cout << "New window:\n"
-              << "\tsize: " << window.getSize()
-              << "\trequested: " << sf::Vector2u(mode.width, mode.height) << "\n" << std::endl;
-}
+    // Everything still queued is written on exit
+    ~StdoutSink()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        wakeup.notify_one();
+        writer.join();
+    }
 
-void goWindowed(sf::Window& window)
-{
-    createWindow(window, sf::VideoMode(800, 600), sf::Style::Default);
-}
+    void write(LogRecord const& record) { push({ record, {} }); }
 
-void goFullscreen(sf::Window& window)
-{
-    auto mode = sf::VideoMode::getDesktopMode();
-    createWindow(window, mode, sf::Style::Fullscreen);
-}
+    void write(std::string text) { push({ LogRecord::make(LogRecord::String, ""), std::move(text) }); }
 
-void drawBorder(sf::RenderWindow& window)
-{
-    sf::RectangleShape borders{ static_cast<sf::Vector2f>(window.getSize()) };
-    borders.setFillColor(sf::Color::Transparent);
-    borders.setOutlineColor(sf::Color::White);
-    borders.setOutlineThickness(-20);
-    window.draw(borders);
-}
+    std::size_t droppedLines() const { return dropped.load(std::memory_order_relaxed); }
+    std::size_t queueHighWaterMark() const { return highWaterMark.load(std::memory_order_relaxed); }
+    std::size_t queueCapacity() const { return queue.capacity(); }
 
-void drawGrid(sf::RenderWindow& window, std::size_t size)
-{
-    std::vector<sf::Vertex> vertexes;
+private:
+    struct Line
+    {
+        LogRecord record;
+        std::string text; // for LogRecord::String only
+    };
 
-    float const h = window.getSize().y;
-    float const w = window.getSize().x;
+    void push(Line&& line)
+    {
+        while (!queue.push(std::move(line)))
+        {
+            if (policy.overflow == Overflow::Drop)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            std::this_thread::yield();
+        }
 
-    for (float y = 0.f; y <= h; y += size) {
-        vertexes.push_back(sf::Vertex({0, y-1}, sf::Color::Green));
-        vertexes.push_back(sf::Vertex({w, y-1}, sf::Color::Green));
-        vertexes.push_back(sf::Vertex({0, y}, sf::Color::Green));
-        vertexes.push_back(sf::Vertex({w, y}, sf::Color::Green));
-        vertexes.push_back(sf::Vertex({0, y+1}, sf::Color::Green));
-        vertexes.push_back(sf::Vertex({w, y+1}, sf::Color::Green));
-    }
+        auto const depth = queue.size();
+        if (depth > highWaterMark.load(std::memory_order_relaxed))
+            highWaterMark.store(depth, std::memory_order_relaxed);
 
-    for (float x = 0.f; x <= w; x += size) {
-        vertexes.push_back(sf::Vertex({x-1, 0}, sf::Color::Green));
-        vertexes.push_back(sf::Vertex({x-1, h}, sf::Color::Green));
-        vertexes.push_back(sf::Vertex({x, 0}, sf::Color::Green));
-        vertexes.push_back(sf::Vertex({x, h}, sf::Color::Green));
-        vertexes.push_back(sf::Vertex({x+1, 0}, sf::Color::Green));
-        vertexes.push_back(sf::Vertex({x+1, h}, sf::Color::Green));
+        // Pairs with the fence in wait(): either the writer sees the line or
+        // this sees it asleep. Only then is the mutex taken.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load(std::memory_order_relaxed))
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            wakeup.notify_one();
+        }
     }
 
-    window.draw(vertexes.data(), vertexes.size(), sf::Lines);
-}
+    // Sleep until a line is pushed, the sink stops or `timeout` expires
+    void wait(std::optional<sf::Time> timeout)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
 
-void printVideoModes()
-{
-    std::cout << "Fullscreen modes:\n";
-    for (auto mode : sf::VideoMode::getFullscreenModes()) {
-        std::cout << "\t" << mode.width << "x" << mode.height << "\n";
+        auto const woken = [&] { return queue.size() > 0 || !running; };
+        if (timeout)
+            wakeup.wait_for(lock, std::chrono::microseconds(timeout->asMicroseconds()), woken);
+        else
+            wakeup.wait(lock, woken);
+        sleeping.store(false, std::memory_order_relaxed);
     }
-    auto desktop = sf::VideoMode::getDesktopMode();
-    std::cout << "Desktop mode:\n\t" << desktop.width << "x" << desktop.height << "\n";
-}
-
-int main(int, char const**)
-{
-    std::setlocale(LC_ALL, "");
 
-    printVideoModes();
+    void run()
+    {
+        std::string buffer;
+        buffer.reserve(policy.flushSize * 2);
+        sf::Clock sinceFlush;
+
+        auto flush = [&] {
+            std::fwrite(buffer.data(), 1, buffer.size(), stdout);
+            std::fflush(stdout);
+            buffer.clear();
+            sinceFlush.restart();
+        };
+
+        Line line;
+        char text[256];
+        for (;;)
+        {
+            // Read `running` before draining so nothing pushed before the stop is missed
+            bool const stopping = !running;
 
-    // Create the main window
-    sf::RenderWindow window;
-    goWindowed(window);
+            bool idle = true;
+            while (buffer.size() < policy.flushSize && queue.pop(line))
+            {
+                buffer += "Log: ";
+                if (line.record.kind == LogRecord::String)
+                    buffer += line.text;
+                else
+                    buffer.append(text, formatRecord(line.record, text, text + sizeof(text)));
+                buffer += '\n';
+                idle = false;
+            }
 
-    // Set the Icon
-    sf::Image icon;
-    assert(icon.loadFromFile(resourcePath() + "icon.png"));
+            if (!buffer.empty() &&
+                (stopping || buffer.size() >= policy.flushSize || sinceFlush.getElapsedTime() >= policy.interval))
+                flush();
 
-    window.setIcon(icon.getSize().x, icon.getSize().y, icon.getPixelsPtr());
+            if (idle && stopping)
+                break;
 
-    // Load our font
-    sf::Font font;
-    // auto const file = "sansation.ttf";
-    auto const file = "FiraCode-Light.ttf";
-    // auto const file = "HelveticaNeue.ttf";
-    assert(font.loadFromFile(resourcePath() + file));
+            // Pending text is flushed once the interval expires
+            if (idle && buffer.empty())
+                wait(std::nullopt);
+            else if (idle)
+                wait(policy.interval - sinceFlush.getElapsedTime());
+        }
+    }
 
-    sf::CircleShape cursorShape;
-    cursorShape.setRadius(20.f);
-    cursorShape.setOrigin(20.f, 20.f);
-    cursorShape.setFillColor(sf::Color::Red);
+private:
+    Policy policy;
+    SpscQueue<Line> queue;
+    std::mutex mutex; // only taken to sleep and to wake the writer up
+    std::condition_variable wakeup;
+    std::atomic<bool> sleeping{ false };
+    std::atomic<bool> running{ true };
+    std::atomic<std::size_t> dropped{ 0 };
+    std::atomic<std::size_t> highWaterMark{ 0 };
+    std::thread writer; // last, so it starts once everything else is ready
+};
 
-    // Create a logger
-    GraphicLogger logger{ font, 20, 20 };
-    logger.setPosition(50, 50);
-    JoystickTable joyInfo{ font, 20 };
-    joyInfo.setPosition(50, 50);
-    bool displayJoystickTable = false;
 
-    sf::Cursor cursor;
 
-    sf::Event::EventType lastType = sf::Event::Count;
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
 
-    std::map<sf::Joystick::Axis, sf::Clock> axisClocks;
+    ~MappedFile()
+    {
+        if (address)
+            ::munmap(const_cast<char*>(address), length);
+    }
 
-    // Start the game loop
-    while (window.isOpen())
+    bool open(std::string const& path)
     {
-        // Process events
-        sf::Event event;
-        while (window.pollEvent(event))
-        {
-            // Close window : exit
-            if (event.type == sf::Event::Closed)
-            {
-                // window.close();
-            }
+        int const fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1)
+            return false;
 
-// Log events
-#define LOGEvent(type)                                                                             \
-    case sf::Event::type:                                                                          \
-        logger.log(#type)
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            length = info.st_size;
+            void* mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            address = mapping == MAP_FAILED ? nullptr : static_cast<char const*>(mapping);
+        }
+        ::close(fd);
+        return address != nullptr;
+    }
 
-#define LOGXY(var)                                                                                 \
-    logger.log(std::string(#var) + ": (" + std::to_string(var.x) + "; " + std::to_string(var.y) + ")")
+    char const* data() const { return address; }
+    std::size_t size() const { return length; }
 
-#define LOGWheel(var) logger.log(std::string(#var) + ": delta = " + std::to_string(var.delta))
+private:
+    char const* address = nullptr;
+    std::size_t length = 0;
+};
 
-#define LOGWidthHeight(var)                                                                        \
-    logger.log(std::string(#var) + ": (" + std::to_string(var.width) + "; " +                      \
-               std::to_string(var.height) + ")")
 
-#define LOGKey(var)                                                                                \
-    logger.log(key2string(var.key.code) +                                                          \
-               (var.type == sf::Event::KeyPressed ? " was pressed" : " was released"))
 
-#define LOGButton(var)                                                                             \
-    logger.log(button2string(var.mouseButton.button) +                                             \
-               (var.type == sf::Event::MouseButtonPressed ? " was pressed" : " was released"))
+// Every log line, kept in segment files of fixed-size records written through
+// a shared memory mapping, so that the history survives a crash and is only
+// bounded by the disk. Only the segment being written and the last few read
+// are mapped, so memory use does not grow with the history.
+struct HistoryRecord
+{
+    sf::Int64 timestamp; // in microseconds
+    sf::Int16 key;       // sf::Keyboard::Unknown unless logged for a key event
+    sf::Uint8 eventType; // sf::Event::Count unless logged for an event
+    sf::Uint8 kind;      // LogRecord::Kind
+    sf::Uint8 length;    // of the UTF-8 text
+    char reserved[3];
+    char text[112];
+};
 
-            if (event.type != sf::Event::MouseMoved || lastType != sf::Event::MouseMoved)
-                switch (event.type)
-                {
-                    LOGEvent(Closed);
-                    break;
+struct HistorySegmentHeader
+{
+    char magic[8];
+    sf::Uint32 version;
+    sf::Uint32 recordSize;
+    sf::Uint64 records; // written so far in this segment
+    char reserved[104];
+};
 
-                    LOGEvent(Resized);
-                    LOGWidthHeight(event.size);
-                    break;
+static_assert(sizeof(HistoryRecord) == 128, "history records are meant to be 128 bytes");
+static_assert(sizeof(HistorySegmentHeader) == sizeof(HistoryRecord), "the segment header takes one record");
 
-                    LOGEvent(LostFocus);
-                    break;
+class LogHistory
+{
+public:
+    static constexpr std::size_t segmentRecords = 32767; // 4 MiB per segment, with the header
 
-                    LOGEvent(GainedFocus);
-                    break;
+    ~LogHistory() { closeSegment(); }
 
-                    LOGEvent(TextEntered);
-                    break;
+    // Segments are named <base>.000000, <base>.000001, ...; those of a
+    // previous run are removed
+    bool open(std::string const& newBase)
+    {
+        base = newBase;
+        for (std::size_t segment = 0; ::unlink(segmentPath(segment).c_str()) == 0; ++segment)
+            continue;
 
-                    LOGEvent(KeyPressed);
-                    LOGKey(event);
-                    break;
+        if (!openSegment(0))
+        {
+            std::cerr << "Cannot create log history " << segmentPath(0) << ": " << std::strerror(errno)
+                      << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool isOpen() const { return data != nullptr; }
+
+    std::size_t size() const { return count; }
+
+    void append(LogRecord const& record, sf::Event::EventType eventType, sf::Keyboard::Key key)
+    {
+        auto entry = makeRecord(record.timestamp, record.kind, eventType, key);
+        entry.length = formatRecord(record, entry.text, entry.text + sizeof(entry.text)) - entry.text;
+        write(entry);
+    }
+
+    // Text longer than a record is truncated on a character boundary
+    void append(std::string_view utf8, sf::Time timestamp, sf::Event::EventType eventType, sf::Keyboard::Key key)
+    {
+        auto entry = makeRecord(timestamp, LogRecord::String, eventType, key);
+        auto length = std::min(utf8.size(), sizeof(entry.text));
+        if (length < utf8.size())
+            while (length > 0 && (static_cast<unsigned char>(utf8[length]) & 0xC0) == 0x80)
+                --length;
+        std::copy_n(utf8.data(), length, entry.text);
+        entry.length = length;
+        write(entry);
+    }
+
+    // A record whose segment cannot be read back, its file being removed or
+    // truncated behind our back, reads as a placeholder
+    HistoryRecord operator[](std::size_t index)
+    {
+        auto const segment = index / segmentRecords;
+        char const* records = segment == writeSegment ? data : readMapping(segment);
+        if (!records)
+        {
+            static constexpr char unreadable[] = "(unreadable)";
+            auto record = makeRecord(sf::Time::Zero, LogRecord::String, sf::Event::Count, sf::Keyboard::Unknown);
+            std::copy_n(unreadable, sizeof(unreadable) - 1, record.text);
+            record.length = sizeof(unreadable) - 1;
+            return record;
+        }
+
+        HistoryRecord record;
+        std::memcpy(&record, records + (1 + index % segmentRecords) * sizeof(HistoryRecord), sizeof(record));
+        return record;
+    }
+
+private:
+    static HistoryRecord makeRecord(sf::Time timestamp, LogRecord::Kind kind, sf::Event::EventType eventType,
+                                    sf::Keyboard::Key key)
+    {
+        HistoryRecord record{};
+        record.timestamp = timestamp.asMicroseconds();
+        record.key = static_cast<sf::Int16>(key);
+        record.eventType = static_cast<sf::Uint8>(eventType);
+        record.kind = kind;
+        return record;
+    }
+
+    std::string segmentPath(std::size_t segment) const
+    {
+        char suffix[24];
+        std::snprintf(suffix, sizeof(suffix), ".%06zu", segment);
+        return base + suffix;
+    }
+
+    static constexpr std::size_t segmentBytes() { return (1 + segmentRecords) * sizeof(HistoryRecord); }
+
+    // The segment being written is only replaced once the new one is mapped
+    bool openSegment(std::size_t segment)
+    {
+        auto const path = segmentPath(segment);
+        int const fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1)
+            return false;
+
+        char* mapping = nullptr;
+        if (::ftruncate(fd, segmentBytes()) == 0)
+        {
+            void* address = ::mmap(nullptr, segmentBytes(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            mapping = address == MAP_FAILED ? nullptr : static_cast<char*>(address);
+        }
+        ::close(fd);
+        if (!mapping)
+            return false;
+
+        HistorySegmentHeader header{};
+        std::memcpy(header.magic, "SFMLLOG", 8);
+        header.version = 1;
+        header.recordSize = sizeof(HistoryRecord);
+        std::memcpy(mapping, &header, sizeof(header));
+
+        closeSegment();
+        data = mapping;
+        writeSegment = segment;
+        return true;
+    }
+
+    void closeSegment()
+    {
+        if (data)
+            ::munmap(data, segmentBytes());
+        data = nullptr;
+    }
+
+    void write(HistoryRecord const& record)
+    {
+        if (!data || full)
+            return;
+
+        // When the next segment cannot be created, the history stops there;
+        // the full one stays mapped so that it can still be read
+        auto const index = count % segmentRecords;
+        if (index == 0 && count > 0 && !openSegment(count / segmentRecords))
+        {
+            std::cerr << "Cannot extend log history " << segmentPath(count / segmentRecords) << ": "
+                      << std::strerror(errno) << "; no more records are kept" << std::endl;
+            full = true;
+            return;
+        }
+
+        std::memcpy(data + (1 + index) * sizeof(HistoryRecord), &record, sizeof(record));
+        ++count;
+        auto& header = *reinterpret_cast<HistorySegmentHeader*>(data);
+        header.records = index + 1;
+    }
+
+    // Full segments are read through a few read-only mappings, reused in turn.
+    // A segment that cannot be mapped is reported and null, and stays so while
+    // its mapping is reused.
+    char const* readMapping(std::size_t segment)
+    {
+        for (auto const& mapping : readMappings)
+            if (mapping.file && mapping.segment == segment)
+                return mapping.file->data();
+
+        auto& mapping = readMappings[nextReadMapping++ % readMappings.size()];
+        mapping.file = std::make_unique<MappedFile>();
+        mapping.segment = segment;
+        if (!mapping.file->open(segmentPath(segment)) || mapping.file->size() < segmentBytes())
+        {
+            std::cerr << "Cannot read log history " << segmentPath(segment) << std::endl;
+            mapping.file = std::make_unique<MappedFile>();
+        }
+        return mapping.file->data();
+    }
+
+private:
+    struct ReadMapping
+    {
+        std::size_t segment = 0;
+        std::unique_ptr<MappedFile> file;
+    };
+
+    std::string base;
+    char* data = nullptr; // segment being written
+    std::size_t writeSegment = 0;
+    std::size_t count = 0;
+    bool full = false; // the next segment could not be created
+    std::array<ReadMapping, 4> readMappings;
+    std::size_t nextReadMapping = 0;
+};
+
+
+
+class GraphicLogger : public sf::Drawable, public sf::Transformable
+{
+public:
+    GraphicLogger(sf::Font const& font, unsigned int fontSize, unsigned int nbLines)
+        : font(font)
+        , fontSize(fontSize)
+        , entries(nbLines)
+        , prefixes(nbLines)
+        , batch(sf::Triangles)
+    {
+        // The "i: " prefix of a row never changes: lay them out once and for all.
+        for (unsigned int i = 0; i < prefixes.size(); ++i)
+        {
+            auto& prefix = prefixes[i];
+            prefix.end = appendText(prefix.vertices, font, fontSize, std::to_string(i) + ": ",
+                                    sf::Color::White, { 0, 0 }).x;
+        }
+    }
+
+    // Only the fields are stored; the text is laid out at draw time if the
+    // record is still on screen.
+    void log(LogRecord record)
+    {
+        record.timestamp = clock.getElapsedTime();
+        auto& entry = push();
+        entry.record = record;
+
+        if (sink)
+            sink->write(record);
+        if (history)
+            history->append(record, sourceType, sourceKey);
+    }
+
+    void log(sf::String const& msg)
+    {
+        auto& entry = push();
+        entry.record = LogRecord::make(LogRecord::String, "");
+        entry.record.timestamp = clock.getElapsedTime();
+        entry.text.assign(msg.begin(), msg.end());
+
+        if (sink || history)
+        {
+            auto const utf8 = msg.toUtf8();
+            std::string text(utf8.begin(), utf8.end());
+            if (history)
+                history->append(text, entry.record.timestamp, sourceType, sourceKey);
+            if (sink)
+                sink->write(std::move(text));
+        }
+    }
+
+    // Echo logs to the given sink, or nowhere if null
+    void setSink(StdoutSink* newSink) { sink = newSink; }
+
+    // Keep every log in the given history too, or nowhere if null
+    void setHistory(LogHistory* newHistory) { history = newHistory; }
+
+    // The event, and key for a key event, the next logs are about, if any
+    void setSource(sf::Event::EventType type, sf::Keyboard::Key key)
+    {
+        sourceType = type;
+        sourceKey = key;
+    }
+
+    // Changes whenever the drawn content does
+    std::uint64_t getRevision() const { return revision; }
+
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override
+    {
+        if (dirty)
+            updateBatch();
+
+        states.transform *= getTransform();
+        states.texture = &font.getTexture(fontSize);
+        target.draw(batch, states);
+    }
+
+    // Add the rows to `text` rather than drawing them
+    void appendTo(TextBatch& text) const
+    {
+        if (dirty)
+            updateBatch();
+
+        text.append(font.getTexture(fontSize), batch, getTransform());
+    }
+
+private:
+    struct Entry;
+
+    // The oldest entry becomes the newest one
+    Entry& push()
+    {
+        head = (head + entries.size() - 1) % entries.size();
+        auto& entry = entries[head];
+        entry.laidOut = false;
+        dirty = true;
+        ++revision;
+        return entry;
+    }
+
+    void layout(Entry& entry) const
+    {
+        entry.vertices.clear();
+        if (entry.record.kind == LogRecord::String)
+        {
+            appendText(entry.vertices, font, fontSize, entry.text, sf::Color::White, { 0, 0 }, L' ');
+        }
+        else
+        {
+            char text[256];
+            auto const end = formatRecord(entry.record, text, text + sizeof(text));
+            appendText(entry.vertices, font, fontSize, std::string_view(text, end - text), sf::Color::White,
+                       { 0, 0 }, L' ');
+        }
+        entry.laidOut = true;
+    }
+
+    // Assemble all rows into one vertex array by translating the cached geometry
+    void updateBatch() const
+    {
+        batch.clear();
+        for (unsigned int i = 0; i < entries.size(); ++i)
+        {
+            auto const& prefix = prefixes[i];
+            auto& entry = entries[(head + i) % entries.size()];
+            float const y = i * (fontSize * 1.1);
+
+            if (!entry.laidOut)
+                layout(entry);
+
+            for (auto vertex : prefix.vertices)
+            {
+                vertex.position.y += y;
+                batch.append(vertex);
+            }
+
+            for (auto vertex : entry.vertices)
+            {
+                vertex.position.x += prefix.end;
+                vertex.position.y += y;
+                batch.append(vertex);
+            }
+        }
+        dirty = false;
+    }
+
+private:
+    struct Prefix
+    {
+        std::vector<sf::Vertex> vertices;
+        float end = 0; // horizontal pen position after the last glyph
+    };
+
+    struct Entry
+    {
+        LogRecord record;
+        std::basic_string<sf::Uint32> text; // for LogRecord::String only
+        std::vector<sf::Vertex> vertices;
+        bool laidOut = true;
+    };
+
+    sf::Font const& font;
+    unsigned int fontSize;
+    mutable std::vector<Entry> entries; // ring buffer, entries[head] is the most recent log
+    std::vector<Prefix> prefixes;       // one per row
+    std::size_t head = 0;
+    sf::Clock clock;
+    StdoutSink* sink = nullptr;
+    LogHistory* history = nullptr;
+    sf::Event::EventType sourceType = sf::Event::Count;
+    sf::Keyboard::Key sourceKey = sf::Keyboard::Unknown;
+    mutable sf::VertexArray batch;
+    mutable bool dirty = true;
+    std::uint64_t revision = 0;
+};
+
+
+
+
+// Scrollback over the log history, shown instead of the logger while scrolled
+// back or filtered. Only the records needed for the visible rows are read:
+// pages are found by scanning the history from where the view stands, a
+// bounded number of records per update so that a search through millions of
+// records does not freeze the window. It is driven by key binding actions,
+// PageUp / PageDown / End / F1 / F2 by default (see applyViewAction()).
+class HistoryView : public sf::Drawable, public sf::Transformable
+{
+public:
+    HistoryView(LogHistory& history, sf::Font const& font, unsigned int fontSize, unsigned int nbLines)
+        : history(history)
+        , font(font)
+        , fontSize(fontSize)
+        , nbLines(nbLines)
+        , anchor(history.size())
+        , batch(sf::Triangles)
+    {
+        restart();
+    }
+
+    bool isActive() const { return !live || typeFilter || keyFilter; }
+
+    // Remember the last key pressed that triggered no action, for the key filter
+    void handleEvent(sf::Event const& event)
+    {
+        if (event.type == sf::Event::KeyPressed)
+            lastKey = event.key.code;
+    }
+
+    // Older page
+    void pageUp()
+    {
+        // Records between the scan position and the anchor don't match
+        if (visible.empty() && complete)
+            return;
+        live = false;
+        anchor = complete ? visible.back() : scanPosition;
+        restart();
+    }
+
+    // Newer page. The anchor moves past the next page of matching records, as
+    // far as the scan budget allows.
+    void pageDown()
+    {
+        if (live)
+            return;
+
+        auto const size = history.size();
+        std::size_t found = 0;
+        for (std::size_t budget = scanBudget; anchor < size && found < nbLines && budget > 0; --budget)
+            found += matches(history[anchor++]);
+
+        live = anchor == size;
+        restart();
+    }
+
+    // Back to the latest records, following new ones
+    void showLatest()
+    {
+        live = true;
+        anchor = history.size();
+        restart();
+    }
+
+    // Next event type filter: all, Closed, Resized, ...
+    void nextTypeFilter()
+    {
+        auto const next = typeFilter ? *typeFilter + 1 : 0;
+        if (next < sf::Event::Count)
+            typeFilter = static_cast<sf::Event::EventType>(next);
+        else
+            typeFilter.reset();
+        filterChanged();
+    }
+
+    // Filter on the last key pressed, or stop filtering on a key
+    void toggleKeyFilter()
+    {
+        if (keyFilter)
+            keyFilter.reset();
+        else if (lastKey != sf::Keyboard::Unknown)
+            keyFilter = lastKey;
+        filterChanged();
+    }
+
+    // Look for the visible records, within the scan budget, and lay them out
+    // if they changed
+    void update()
+    {
+        std::size_t budget = scanBudget;
+
+        // While following the history, new records come first, unless there
+        // are too many of them to go through: look again from the end then
+        auto const size = history.size();
+        if (live && size - anchor > scanBudget)
+        {
+            anchor = size;
+            restart();
+        }
+        for (; live && anchor < size && budget > 0; --budget, ++anchor)
+        {
+            if (!matches(history[anchor]))
+                continue;
+            visible.insert(visible.begin(), anchor);
+            if (visible.size() > nbLines)
+                visible.pop_back();
+            dirty = true;
+        }
+
+        for (; !complete && scanPosition > 0 && budget > 0; --budget)
+        {
+            if (matches(history[--scanPosition]))
+            {
+                visible.push_back(scanPosition);
+                dirty = true;
+            }
+            complete = visible.size() == nbLines || scanPosition == 0;
+        }
+
+        if (isActive() && (dirty || displayedSize != size))
+            layout();
+    }
+
+    // Changes whenever the drawn content does
+    std::uint64_t getRevision() const { return revision; }
+
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override
+    {
+        states.transform *= getTransform();
+        states.texture = &font.getTexture(fontSize);
+        target.draw(batch, states);
+    }
+
+    // Add the rows to `text` rather than drawing them
+    void appendTo(TextBatch& text) const { text.append(font.getTexture(fontSize), batch, getTransform()); }
+
+private:
+    static constexpr std::size_t scanBudget = 16384; // records per update
+
+    bool matches(HistoryRecord const& record) const
+    {
+        return (!typeFilter || record.eventType == *typeFilter) && (!keyFilter || record.key == *keyFilter);
+    }
+
+    // Look again for the records before the anchor
+    void restart()
+    {
+        visible.clear();
+        scanPosition = anchor;
+        complete = scanPosition == 0;
+        dirty = true;
+    }
+
+    void filterChanged()
+    {
+        if (live)
+            anchor = history.size();
+        restart();
+    }
+
+    void layout()
+    {
+        displayedSize = history.size();
+        dirty = false;
+        ++revision;
+
+        auto title = "History: " + std::to_string(displayedSize) + " records";
+        if (typeFilter)
+            title += ", type " + std::string(eventType2string(*typeFilter));
+        if (keyFilter)
+            title += ", key " + std::string(key2string(*keyFilter));
+        if (!complete)
+            title += ", searching...";
+
+        std::vector<sf::Vertex> vertices;
+        appendText(vertices, font, fontSize, title, sf::Color::Cyan, { 0, 0 });
+
+        float y = fontSize * 1.1f;
+        for (auto index : visible)
+        {
+            auto const record = history[index];
+            char prefix[32];
+            std::snprintf(prefix, sizeof(prefix), "%zu: ", index);
+            auto const x = appendText(vertices, font, fontSize, std::string_view(prefix), sf::Color(128, 128, 128),
+                                      { 0, y }).x;
+            auto const text = sf::String::fromUtf8(record.text, record.text + record.length);
+            appendText(vertices, font, fontSize, text, sf::Color::White, { x, y }, L' ');
+            y += fontSize * 1.1f;
+        }
+
+        batch.clear();
+        for (auto const& vertex : vertices)
+            batch.append(vertex);
+    }
+
+private:
+    LogHistory& history;
+    sf::Font const& font;
+    unsigned int fontSize;
+    std::size_t nbLines;
+
+    bool live = true;          // following new records
+    std::size_t anchor = 0;    // the visible records are the last matching ones before it
+    std::size_t scanPosition = 0;
+    bool complete = true;      // no more visible records to look for
+    std::vector<std::size_t> visible; // newest first
+    std::optional<sf::Event::EventType> typeFilter;
+    std::optional<sf::Keyboard::Key> keyFilter;
+    sf::Keyboard::Key lastKey = sf::Keyboard::Unknown;
+
+    bool dirty = true;
+    std::size_t displayedSize = 0;
+    sf::VertexArray batch;
+    std::uint64_t revision = 0;
+};
+
+
+
+// Code points kept around a gap at the cursor, so that typing, erasing and
+// pasting there cost the size of the change whatever the size of the text.
+// Moving the cursor costs the distance moved.
+class GapBuffer
+{
+public:
+    std::size_t size() const { return text.size() - (gapEnd - gapBegin); }
+    std::size_t cursor() const { return gapBegin; }
+
+    char32_t operator[](std::size_t i) const { return text[i < gapBegin ? i : i + (gapEnd - gapBegin)]; }
+
+    // Insert [first, last) before the cursor
+    template <class Iterator>
+    void insert(Iterator first, Iterator last)
+    {
+        auto const count = static_cast<std::size_t>(std::distance(first, last));
+        reserveGap(count);
+        std::copy(first, last, text.begin() + gapBegin);
+        gapBegin += count;
+    }
+
+    // Erase the code point before the cursor
+    void erase()
+    {
+        if (gapBegin > 0)
+            --gapBegin;
+    }
+
+    void moveCursor(std::size_t position)
+    {
+        position = std::min(position, size());
+        if (position < gapBegin)
+        {
+            std::move_backward(text.begin() + position, text.begin() + gapBegin, text.begin() + gapEnd);
+            gapEnd -= gapBegin - position;
+            gapBegin = position;
+        }
+        else if (position > gapBegin)
+        {
+            auto const count = position - gapBegin;
+            std::move(text.begin() + gapEnd, text.begin() + gapEnd + count, text.begin() + gapBegin);
+            gapBegin += count;
+            gapEnd += count;
+        }
+    }
+
+private:
+    // Make room for `count` code points, at least doubling the buffer
+    void reserveGap(std::size_t count)
+    {
+        if (gapEnd - gapBegin >= count)
+            return;
+
+        auto const tail = text.size() - gapEnd;
+        text.resize(std::max(text.size() * 2, size() + count + 64));
+        std::move_backward(text.begin() + gapEnd, text.begin() + gapEnd + tail, text.end());
+        gapEnd = text.size() - tail;
+    }
+
+private:
+    std::vector<char32_t> text;
+    std::size_t gapBegin = 0;
+    std::size_t gapEnd = 0;
+};
+
+// Text typed into the window while text input is on. TextEntered code points
+// go into a gap buffer: Backspace erases and Return starts a new line; the
+// cursor-left, cursor-right and paste-text actions move the cursor and paste
+// the clipboard (see applyViewAction()). Rows
+// wrap after `columns` characters. Only the rows around the cursor are read
+// and laid out, so editing and drawing cost the same with a few characters or
+// with megabytes of them.
+class InputPanel : public sf::Drawable, public sf::Transformable
+{
+public:
+    InputPanel(sf::Font const& font, unsigned int fontSize, std::size_t nbRows, std::size_t columns)
+        : font(font)
+        , fontSize(fontSize)
+        , nbRows(nbRows)
+        , columns(columns)
+        , batch(sf::Triangles)
+    {
+    }
+
+    void handleEvent(sf::Event const& event)
+    {
+        if (event.type == sf::Event::TextEntered)
+            type(event.text.unicode);
+    }
+
+    // Apply a TextEntered code point. Control characters other than
+    // Backspace and Return, such as the one sent along Control+V, are ignored.
+    void type(char32_t c)
+    {
+        if (c == U'\b')
+            buffer.erase();
+        else if (c == U'\r' || c == U'\n')
+            buffer.insert(U"\n", U"\n" + 1);
+        else if (c == U'\t' || (c >= 0x20 && c != 0x7F))
+            buffer.insert(&c, &c + 1);
+        else
+            return;
+        dirty = true;
+    }
+
+    template <class Iterator>
+    void paste(Iterator first, Iterator last)
+    {
+        buffer.insert(first, last);
+        dirty = true;
+    }
+
+    void moveCursor(std::size_t position)
+    {
+        buffer.moveCursor(position);
+        dirty = true;
+    }
+
+    std::size_t cursor() const { return buffer.cursor(); }
+
+    std::size_t size() const { return buffer.size(); }
+
+    // Lay out the rows around the cursor if the text or the cursor changed
+    void update()
+    {
+        if (dirty)
+            layout();
+    }
+
+    // Changes whenever the drawn content does
+    std::uint64_t getRevision() const { return revision; }
+
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override
+    {
+        states.transform *= getTransform();
+        states.texture = &font.getTexture(fontSize);
+        target.draw(batch, states);
+    }
+
+    // Add the rows to `text` rather than drawing them
+    void appendTo(TextBatch& text) const { text.append(font.getTexture(fontSize), batch, getTransform()); }
+
+private:
+    // Split the text around the cursor into rows, [begin, end) each. Far
+    // enough from the cursor for nbRows rows to fit before it, where lines
+    // start is not known: rows are then aligned as if a line started at a
+    // multiple of `columns`.
+    void splitRows()
+    {
+        auto const span = nbRows * (columns + 1);
+        auto const cursor = buffer.cursor();
+        auto const first = cursor > span ? cursor - span : 0;
+        auto const last = std::min(buffer.size(), cursor + span);
+
+        rows.clear();
+        cursorRow = 0;
+        std::size_t begin = first;
+        std::size_t column = first % columns;
+        for (auto i = first; i < last; ++i)
+        {
+            auto const c = buffer[i];
+            if (column >= columns && c != U'\n')
+            {
+                rows.emplace_back(begin, i);
+                begin = i;
+                column = 0;
+            }
+            if (i == cursor)
+                cursorRow = rows.size();
+
+            if (c == U'\n')
+            {
+                rows.emplace_back(begin, i);
+                begin = i + 1;
+                column = 0;
+            }
+            else
+            {
+                column += c == U'\t' ? 4 : 1;
+            }
+        }
+        if (cursor == last)
+            cursorRow = rows.size();
+        rows.emplace_back(begin, last);
+    }
+
+    void layout()
+    {
+        dirty = false;
+        ++revision;
+
+        splitRows();
+
+        std::vector<sf::Vertex> vertices;
+        char title[96];
+        std::snprintf(title, sizeof(title), "Text input: %zu characters, cursor at %zu", buffer.size(),
+                      buffer.cursor());
+        appendText(vertices, font, fontSize, std::string_view(title), sf::Color::Cyan, { 0, 0 });
+
+        auto const caretOffset = font.getGlyph(U'|', fontSize, false).advance / 2;
+        auto const firstRow = cursorRow + 1 > nbRows ? cursorRow + 1 - nbRows : 0;
+        float y = fontSize * 1.1f;
+        for (auto r = firstRow; r < std::min(rows.size(), firstRow + nbRows); ++r)
+        {
+            auto const [begin, end] = rows[r];
+            auto const split = r == cursorRow ? buffer.cursor() : end;
+
+            before.clear();
+            after.clear();
+            for (auto i = begin; i < end; ++i)
+            {
+                // Control characters (e.g. pasted carriage returns) have no glyph
+                auto const c = buffer[i];
+                if (c == U'\t' || (c >= 0x20 && c != 0x7F))
+                    (i < split ? before : after) += c;
+            }
+
+            auto const pen = appendText(vertices, font, fontSize, before, sf::Color::White, { 0, y });
+            appendText(vertices, font, fontSize, after, sf::Color::White, pen, before.empty() ? 0 : before.back());
+            if (r == cursorRow)
+                appendText(vertices, font, fontSize, std::u32string_view(U"|"), sf::Color::Yellow,
+                           { pen.x - caretOffset, y });
+            y += fontSize * 1.1f;
+        }
+
+        batch.clear();
+        for (auto const& vertex : vertices)
+            batch.append(vertex);
+    }
+
+private:
+    sf::Font const& font;
+    unsigned int fontSize;
+    std::size_t nbRows;
+    std::size_t columns;
+
+    GapBuffer buffer;
+    std::vector<std::pair<std::size_t, std::size_t>> rows; // around the cursor
+    std::size_t cursorRow = 0;
+    std::u32string before, after; // text of a row, before and after the cursor
+
+    bool dirty = true;
+    sf::VertexArray batch;
+    std::uint64_t revision = 0;
+};
+
+
+
+// State of every joystick at one instant
+struct JoystickSample
+{
+    bool connected = false;
+    unsigned int buttonCount = 0;
+    sf::Uint32 buttons = 0; // bit b is set while button b is pressed
+    std::array<float, sf::Joystick::AxisCount> axes{};
+};
+
+using JoystickSamples = std::array<JoystickSample, sf::Joystick::Count>;
+
+static_assert(sf::Joystick::ButtonCount <= 32, "joystick buttons don't fit in JoystickSample::buttons");
+
+// Read the joystick states as last updated by SFML
+void sampleJoysticks(JoystickSamples& samples)
+{
+    for (unsigned int id = 0; id < sf::Joystick::Count; ++id)
+    {
+        auto& sample = samples[id];
+        sample.connected = sf::Joystick::isConnected(id);
+        sample.buttonCount = sample.connected ? sf::Joystick::getButtonCount(id) : 0;
+        sample.buttons = 0;
+        for (unsigned int b = 0; b < sample.buttonCount; ++b)
+            sample.buttons |= sf::Uint32(sf::Joystick::isButtonPressed(id, b)) << b;
+        for (int i = 0; i < sf::Joystick::AxisCount; ++i)
+            sample.axes[i] = sample.connected ? sf::Joystick::getAxisPosition(id, static_cast<sf::Joystick::Axis>(i))
+                                              : std::numeric_limits<float>::quiet_NaN();
+    }
+}
+
+// Statistics of an axis over the last second
+struct AxisStatistics
+{
+    float min = 0;
+    float max = 0;
+    float jitter = 0;         // standard deviation of the position
+    unsigned int reports = 0; // number of times the position changed
+};
+
+// What the joystick sampler publishes
+struct JoystickSnapshot
+{
+    JoystickSamples latest;
+    std::array<std::array<AxisStatistics, sf::Joystick::AxisCount>, sf::Joystick::Count> statistics;
+    unsigned int sampleRate = 0; // samples taken over the last second
+};
+
+
+
+// Axis values and buttons of every connected joystick, or of none, and the
+// sampler statistics of the active one when they are available. Each cell is
+// laid out once and again only when its displayed value changes; all cells
+// are drawn as a single batch.
+class JoystickTable : public sf::Drawable, public sf::Transformable
+{
+public:
+    JoystickTable(sf::Font const& font, unsigned int fontSize)
+    : font(font), fontSize(fontSize), batch(sf::Triangles)
+    {
+        update();
+    }
+
+    // Read the joysticks directly
+    void update()
+    {
+        JoystickSamples samples;
+        sampleJoysticks(samples);
+        update(samples, nullptr);
+    }
+
+    // Show what the joystick sampler published
+    void update(JoystickSnapshot const& snapshot) { update(snapshot.latest, &snapshot); }
+
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override
+    {
+        states.transform *= getTransform();
+        states.texture = &font.getTexture(fontSize);
+        target.draw(batch, states);
+    }
+
+    // Add the cells to `text` rather than drawing them
+    void appendTo(TextBatch& text) const { text.append(font.getTexture(fontSize), batch, getTransform()); }
+
+    void setJoystick(unsigned int idx) { activeJoystickId = idx; }
+
+    // Changes whenever the drawn content does
+    std::uint64_t getRevision() const { return revision; }
+
+private:
+    struct Cell
+    {
+        std::int64_t value = std::numeric_limits<std::int64_t>::max(); // what is displayed
+        std::vector<sf::Vertex> vertices;
+    };
+
+    struct Column
+    {
+        bool shown = false;
+        std::size_t slot = 0; // position among the shown columns
+        Cell header;
+        std::array<Cell, sf::Joystick::AxisCount> axes;
+        std::array<Cell, sf::Joystick::ButtonCount / 8> buttons; // 8 per row
+    };
+
+    void update(JoystickSamples const& samples, JoystickSnapshot const* snapshot)
+    {
+        bool anyConnected = false;
+        for (auto const& sample : samples)
+            anyConnected = anyConnected || sample.connected;
+
+        std::size_t slot = 0;
+        for (unsigned int id = 0; id < sf::Joystick::Count; ++id)
+        {
+            auto& column = columns[id];
+            auto const& sample = samples[id];
+
+            // Without any joystick, the first column shows NaN values
+            bool const shown = sample.connected || (id == 0 && !anyConnected);
+            if (shown != column.shown || (shown && slot != column.slot))
+                dirty = true;
+            column.shown = shown;
+            if (!shown)
+                continue;
+            column.slot = slot++;
+
+            updateHeader(column.header, id, sample.connected);
+
+            for (int i = 0; i < sf::Joystick::AxisCount; ++i)
+                updateAxis(column.axes[i], static_cast<sf::Joystick::Axis>(i), sample.axes[i]);
+
+            for (unsigned int row = 0; row < column.buttons.size(); ++row)
+                updateButtons(column.buttons[row], sample, row * 8);
+        }
+
+        updateStatistics(samples, snapshot);
+
+        if (dirty)
+            updateBatch();
+    }
+
+    // Lay out the text of `cell` if `value` differs from the displayed one
+    template <class String>
+    void setCell(Cell& cell, std::int64_t value, String const& text, sf::Color color)
+    {
+        if (cell.value == value)
+            return;
+
+        cell.value = value;
+        cell.vertices.clear();
+        appendText(cell.vertices, font, fontSize, text, color, { 0, 0 });
+        dirty = true;
+    }
+
+    // Lay out `text` if it differs from the displayed one, compared by hash
+    void setCell(Cell& cell, std::string_view text, sf::Color color)
+    {
+        std::uint64_t hash = 14695981039346656037ull; // FNV-1a
+        for (unsigned char c : text)
+            hash = (hash ^ c) * 1099511628211ull;
+        setCell(cell, static_cast<std::int64_t>(hash), text, color);
+    }
+
+    void updateHeader(Cell& cell, unsigned int id, bool connected)
+    {
+        bool const active = id == activeJoystickId;
+        if (cell.value == connected * 2 + active)
+            return;
+
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), connected ? "Joystick %u" : "No joystick", id);
+        setCell(cell, connected * 2 + active, std::string_view(buffer),
+                active ? sf::Color::Yellow : sf::Color::White);
+    }
+
+    void updateAxis(Cell& cell, sf::Joystick::Axis axis, float value)
+    {
+        // Values are displayed with 3 decimals
+        auto const quantized = std::isnan(value) ? std::numeric_limits<std::int64_t>::min()
+                                                 : std::llround(value * 1000);
+        if (cell.value == quantized)
+            return;
+
+        char buffer[64];
+        auto const name = axis2string(axis);
+        auto const n = std::snprintf(buffer, sizeof(buffer), "%.*s: %.3f", static_cast<int>(name.size()), name.data(),
+                                     value);
+        setCell(cell, quantized, std::string_view(buffer, std::clamp<int>(n, 0, sizeof(buffer) - 1)),
+                sf::Color::White);
+    }
+
+    // One row shows 8 buttons: '#' when pressed, '.' when released
+    void updateButtons(Cell& cell, JoystickSample const& sample, unsigned int first)
+    {
+        auto const count = sample.buttonCount;
+        std::int64_t const state = count | std::int64_t((sample.buttons >> first) & 0xFF) << 32;
+        if (cell.value == state)
+            return;
+
+        char buffer[32];
+        int const n = std::snprintf(buffer, sizeof(buffer), "B%u:%s", first, first < 10 ? "  " : " ");
+        for (unsigned int b = first; b < first + 8; ++b)
+            buffer[n + b - first] = b >= count ? ' ' : (sample.buttons >> b) & 1 ? '#' : '.';
+        setCell(cell, state, std::string_view(buffer, n + 8), sf::Color::White);
+    }
+
+    // Sampling rate and, for each axis of the active joystick (or the first
+    // connected one): range, jitter and position reports over the last second
+    void updateStatistics(JoystickSamples const& samples, JoystickSnapshot const* snapshot)
+    {
+        unsigned int id = activeJoystickId;
+        if (id >= sf::Joystick::Count || !samples[id].connected)
+        {
+            id = 0;
+            while (id < sf::Joystick::Count && !samples[id].connected)
+                ++id;
+        }
+
+        bool const shown = snapshot && id < sf::Joystick::Count;
+        if (shown != statisticsShown)
+            dirty = true;
+        statisticsShown = shown;
+        if (!shown)
+            return;
+
+        char buffer[64];
+        std::snprintf(buffer, sizeof(buffer), "Joystick %u sampled at %u Hz", id, snapshot->sampleRate);
+        setCell(statistics[0], buffer, sf::Color::Cyan);
+        for (int i = 0; i < sf::Joystick::AxisCount; ++i)
+        {
+            auto const& axis = snapshot->statistics[id][i];
+            auto const name = axis2string(static_cast<sf::Joystick::Axis>(i));
+            std::snprintf(buffer, sizeof(buffer), "%.*s: [%.1f, %.1f] jitter %.3f, %u reports/s",
+                          static_cast<int>(name.size()), name.data(), axis.min, axis.max, axis.jitter, axis.reports);
+            setCell(statistics[i + 1], buffer, sf::Color::Cyan);
+        }
+    }
+
+    // Assemble the shown columns into one vertex array, 4 columns per row,
+    // and the statistics below them
+    void updateBatch()
+    {
+        auto const step = static_cast<float>(fontSize + 3);
+        auto const columnWidth = font.getGlyph(L'0', fontSize, false).advance * 16;
+        auto const columnHeight = step * (2 + sf::Joystick::AxisCount + columns[0].buttons.size());
+
+        auto append = [&](Cell const& cell, sf::Vector2f offset) {
+            for (auto vertex : cell.vertices)
+            {
+                vertex.position += offset;
+                batch.append(vertex);
+            }
+        };
+
+        batch.clear();
+        std::size_t rows = 0;
+        for (auto const& column : columns)
+        {
+            if (!column.shown)
+                continue;
+
+            sf::Vector2f const origin((column.slot % 4) * columnWidth, (column.slot / 4) * columnHeight);
+            float y = 0;
+            append(column.header, origin);
+            for (auto const& cell : column.axes)
+                append(cell, origin + sf::Vector2f(0, y += step));
+            for (auto const& cell : column.buttons)
+                append(cell, origin + sf::Vector2f(0, y += step));
+            rows = column.slot / 4 + 1;
+        }
+
+        if (statisticsShown)
+        {
+            float y = rows * columnHeight;
+            for (auto const& cell : statistics)
+                append(cell, sf::Vector2f(0, y += step));
+        }
+        dirty = false;
+        ++revision;
+    }
+
+private:
+    std::array<Column, sf::Joystick::Count> columns;
+    std::array<Cell, 1 + sf::Joystick::AxisCount> statistics;
+    bool statisticsShown = false;
+    unsigned int activeJoystickId = -1;
+    sf::Font const& font;
+    unsigned int fontSize;
+    sf::VertexArray batch;
+    bool dirty = true;
+    std::uint64_t revision = 0;
+};
+
+
+
+namespace
+{
+    // SFML updates the joystick states while a window is polled and they
+    // are not thread-safe: sampling from another thread and polling hold it.
+    std::mutex joystickMutex;
+}
+
+class JoystickBackend
+{
+public:
+    virtual ~JoystickBackend() = default;
+
+    virtual void sample(JoystickSamples& samples) = 0;
+};
+
+class SfmlJoystickBackend : public JoystickBackend
+{
+public:
+    void sample(JoystickSamples& samples) override
+    {
+        std::lock_guard<std::mutex> lock(joystickMutex);
+        sf::Joystick::update();
+        sampleJoysticks(samples);
+    }
+};
+
+// Virtual joysticks, to test without any device: their axes follow sine waves
+// of different frequencies plus some noise and report a new position at
+// 250 Hz, like a typical USB gamepad; one button changes every second.
+class MockJoystickBackend : public JoystickBackend
+{
+public:
+    explicit MockJoystickBackend(unsigned int count)
+        : count(std::min(count, static_cast<unsigned int>(sf::Joystick::Count)))
+    {
+    }
+
+    void sample(JoystickSamples& samples) override
+    {
+        auto const reports = clock.getElapsedTime().asMicroseconds() / 4000;
+        auto const time = reports * 0.004f;
+        std::minstd_rand random(static_cast<std::minstd_rand::result_type>(reports + 1));
+        std::uniform_real_distribution<float> noise(-0.5f, 0.5f);
+
+        for (unsigned int id = 0; id < sf::Joystick::Count; ++id)
+        {
+            auto& sample = samples[id];
+            sample.connected = id < count;
+            sample.buttonCount = sample.connected ? 12 : 0;
+            sample.buttons = sample.connected ? 1u << (static_cast<unsigned int>(time) % 12) : 0;
+            for (int i = 0; i < sf::Joystick::AxisCount; ++i)
+                sample.axes[i] = sample.connected ? 90 * std::sin(time * (i + 1) * 0.5f + id) + noise(random)
+                                                  : std::numeric_limits<float>::quiet_NaN();
+        }
+    }
+
+private:
+    unsigned int count;
+    sf::Clock clock;
+};
+
+// Sample the joysticks from a thread at a fixed rate, much higher than the
+// frame rate, and publish the latest state together with per-axis statistics
+// over the last second. The render side reads them without locking.
+class JoystickSampler
+{
+public:
+    JoystickSampler(std::unique_ptr<JoystickBackend> backend, unsigned int rate)
+        : backend(std::move(backend))
+        , period(std::chrono::microseconds(1000000 / std::max(rate, 1u)))
+        , sampler(&JoystickSampler::run, this)
+    {
+    }
+
+    ~JoystickSampler()
+    {
+        running = false;
+        sampler.join();
+    }
+
+    // Latest published snapshot; render side only
+    JoystickSnapshot const& snapshot()
+    {
+        snapshots.update();
+        return snapshots.front();
+    }
+
+private:
+    struct Accumulator
+    {
+        float min = std::numeric_limits<float>::infinity();
+        float max = -std::numeric_limits<float>::infinity();
+        double sum = 0;
+        double squares = 0;
+        unsigned int reports = 0;
+    };
+
+    void run()
+    {
+        JoystickSamples samples;
+        JoystickSamples previous;
+        std::array<std::array<Accumulator, sf::Joystick::AxisCount>, sf::Joystick::Count> accumulators;
+        std::array<std::array<AxisStatistics, sf::Joystick::AxisCount>, sf::Joystick::Count> statistics{};
+        unsigned int count = 0;
+        unsigned int sampleRate = 0;
+        sf::Clock window;
+
+        auto next = std::chrono::steady_clock::now();
+        while (running)
+        {
+            backend->sample(samples);
+            ++count;
+
+            for (unsigned int id = 0; id < sf::Joystick::Count; ++id)
+            {
+                if (!samples[id].connected)
+                    continue;
+                for (int i = 0; i < sf::Joystick::AxisCount; ++i)
+                {
+                    auto const value = samples[id].axes[i];
+                    auto& axis = accumulators[id][i];
+                    axis.min = std::min(axis.min, value);
+                    axis.max = std::max(axis.max, value);
+                    axis.sum += value;
+                    axis.squares += value * value;
+                    axis.reports += value != previous[id].axes[i];
+                }
+            }
+            previous = samples;
+
+            if (window.getElapsedTime() >= sf::seconds(1))
+            {
+                for (unsigned int id = 0; id < sf::Joystick::Count; ++id)
+                {
+                    for (int i = 0; i < sf::Joystick::AxisCount; ++i)
+                    {
+                        auto const& axis = accumulators[id][i];
+                        auto& result = statistics[id][i];
+                        auto const mean = axis.sum / count;
+                        result.min = samples[id].connected ? axis.min : 0;
+                        result.max = samples[id].connected ? axis.max : 0;
+                        result.jitter = std::sqrt(std::max(0.0, axis.squares / count - mean * mean));
+                        result.reports = axis.reports;
+                    }
+                }
+                accumulators = {};
+                sampleRate = count;
+                count = 0;
+                window.restart();
+            }
+
+            auto& snapshot = snapshots.back();
+            snapshot.latest = samples;
+            snapshot.statistics = statistics;
+            snapshot.sampleRate = sampleRate;
+            snapshots.publish();
+
+            // Skip the missed samples rather than catching up
+            next += period;
+            auto const now = std::chrono::steady_clock::now();
+            if (next < now)
+                next = now;
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+private:
+    std::unique_ptr<JoystickBackend> backend;
+    std::chrono::microseconds period;
+    TripleBuffer<JoystickSnapshot> snapshots;
+    std::atomic<bool> running{ true };
+    std::thread sampler; // last, so it starts once everything else is ready
+};
+
+
+
+// A fixed set of threads running tasks in submission order. Destroying the
+// pool waits for the tasks already posted.
+class WorkerPool
+{
+public:
+    explicit WorkerPool(unsigned int count)
+    {
+        for (unsigned int i = 0; i < count; ++i)
+            threads.emplace_back(&WorkerPool::run, this);
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+    void post(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        wakeUp.notify_one();
+    }
+
+private:
+    void run()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeUp.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty())
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::deque<std::function<void()>> tasks;
+    bool stopping = false;
+    std::vector<std::thread> threads;
+};
+
+
+
+// Images and fonts found in resourcePath(). Preloaded assets are decoded on a
+// worker pool, in parallel with each other and with the window creation; the
+// others are loaded on first use. Font files are memory-mapped and parsed in
+// place, since sf::Font keeps reading them as long as it lives. When each
+// asset was loaded is recorded, along with the startup milestones passed to
+// mark(), to print a startup timeline.
+class ResourceManager
+{
+public:
+    void preload(std::string const& name)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (assets.count(name) == 0)
+        {
+            auto& asset = add(name, true);
+            pool.post([this, &asset] { load(asset); });
+        }
+    }
+
+    // Block until the asset is loaded; the pointer stays valid as long as the
+    // manager, and is null if the asset could not be loaded
+    sf::Image const* image(std::string const& name)
+    {
+        auto const& asset = get(name);
+        return asset.loaded ? &asset.image : nullptr;
+    }
+
+    sf::Font const* font(std::string const& name)
+    {
+        auto const& asset = get(name);
+        return asset.loaded ? &asset.font : nullptr;
+    }
+
+    void mark(std::string const& milestone)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        milestones.emplace_back(clock.getElapsedTime(), milestone);
+    }
+
+    // Times are in milliseconds since the manager was created
+    void report(std::ostream& out)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto const ms = [](sf::Time time) { return time.asMicroseconds() / 1000.0; };
+        std::vector<std::pair<sf::Int64, std::string>> lines;
+        for (auto const& entry : assets)
+        {
+            auto const& asset = *entry.second;
+            std::ostringstream line;
+            line << std::fixed << std::setprecision(1);
+            if (asset.ready.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                line << std::setw(7) << ms(asset.queued) << " ...        " << asset.name << ", loading";
+                lines.emplace_back(asset.queued.asMicroseconds(), line.str());
+                continue;
+            }
+            line << std::setw(7) << ms(asset.start) << " .. " << std::setw(7) << ms(asset.end) << "  " << asset.name
+                 << (asset.preloaded ? ", preloaded" : ", on first use");
+            if (asset.loaded)
+                line << " (" << ms(asset.end - asset.start) << " to load)";
+            else
+                line << " (failed)";
+            lines.emplace_back(asset.start.asMicroseconds(), line.str());
+        }
+        for (auto const& milestone : milestones)
+        {
+            std::ostringstream line;
+            line << std::fixed << std::setprecision(1) << std::setw(7) << ms(milestone.first) << "            "
+                 << milestone.second;
+            lines.emplace_back(milestone.first.asMicroseconds(), line.str());
+        }
+        std::stable_sort(lines.begin(), lines.end(),
+                         [](auto const& lhs, auto const& rhs) { return lhs.first < rhs.first; });
+
+        out << "Startup timeline (ms):\n";
+        for (auto const& line : lines)
+            out << "\t" << line.second << "\n";
+        out << std::flush;
+    }
+
+private:
+    struct Asset
+    {
+        std::string name;
+        bool preloaded = false;
+        bool loaded = false;
+        sf::Time queued;
+        sf::Time start;
+        sf::Time end;
+        MappedFile file;
+        sf::Image image;
+        sf::Font font;
+        std::promise<void> done;
+        std::shared_future<void> ready;
+    };
+
+    static bool isFont(std::string const& name)
+    {
+        auto const extension = name.substr(name.find_last_of('.') + 1);
+        return extension == "ttf" || extension == "otf";
+    }
+
+    // With the mutex held
+    Asset& add(std::string const& name, bool preloaded)
+    {
+        auto& asset = *assets.emplace(name, std::make_unique<Asset>()).first->second;
+        asset.name = name;
+        asset.preloaded = preloaded;
+        asset.queued = clock.getElapsedTime();
+        asset.ready = asset.done.get_future().share();
+        return asset;
+    }
+
+    Asset const& get(std::string const& name)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto found = assets.find(name);
+        if (found == assets.end())
+        {
+            auto& asset = add(name, false);
+            lock.unlock();
+            load(asset);
+            return asset;
+        }
+
+        auto& asset = *found->second;
+        lock.unlock();
+        asset.ready.wait();
+        return asset;
+    }
+
+    void load(Asset& asset)
+    {
+        auto const path = resourcePath() + asset.name;
+        asset.start = clock.getElapsedTime();
+        if (isFont(asset.name))
+            asset.loaded = asset.file.open(path) && asset.font.loadFromMemory(asset.file.data(), asset.file.size());
+        else
+            asset.loaded = asset.image.loadFromFile(path);
+        if (!asset.loaded)
+            std::cerr << "Cannot load " << path << std::endl;
+        asset.end = clock.getElapsedTime();
+        asset.done.set_value();
+    }
+
+private:
+    sf::Clock clock;
+    std::mutex mutex;
+    std::map<std::string, std::unique_ptr<Asset>> assets;
+    std::vector<std::pair<sf::Time, std::string>> milestones;
+    WorkerPool pool{ std::clamp(std::thread::hardware_concurrency(), 1u, 4u) }; // last, so it stops first
+};
+
+
+
+// Glyph atlases of the fonts shared by everything drawn. SFML keeps font
+// textures in the context shared by all windows, so glyph atlases outlive
+// window re-creation as long as their sf::Font does: prewarming rasterizes a
+// set of characters at every size in use up front, so that neither the first
+// frames nor a window mode switch have to.
+class FontCache
+{
+public:
+    void prewarm(sf::Font const& font, unsigned int size, sf::String const& characters)
+    {
+        for (auto c : characters)
+            font.getGlyph(c, size, false);
+        atlases.emplace(&font, size);
+    }
+
+    // Memory used by the prewarmed atlases, in bytes (RGBA textures)
+    std::size_t atlasBytes() const
+    {
+        std::size_t bytes = 0;
+        for (auto const& atlas : atlases)
+        {
+            auto const size = atlas.first->getTexture(atlas.second).getSize();
+            bytes += size.x * size.y * 4;
+        }
+        return bytes;
+    }
+
+private:
+    std::set<std::pair<sf::Font const*, unsigned int>> atlases;
+};
+
+
+
+template <class T>
+std::ostream& operator<<(std::ostream& out, sf::Vector2<T> const& v)
+{
+    return out << "(" << v.x << "; " << v.y << ")";
+}
+
+
+
+// An event trace is a versioned header followed by fixed-size records, each
+// holding a raw sf::Event and when it was received relative to the start of
+// the recording. Since sf::Event is stored as is, the header also records its
+// layout so a trace from another SFML version is rejected instead of misread.
+struct TraceHeader
+{
+    char magic[8];
+    sf::Uint32 version;
+    sf::Uint32 recordSize;
+    sf::Uint32 eventSize;
+    sf::Uint32 eventTypeCount;
+    sf::Uint64 records;
+};
+
+struct TraceRecord
+{
+    sf::Int64 timestamp; // in microseconds
+    sf::Event event;
+};
+
+char const traceMagic[8] = "SFMLEVT";
+sf::Uint32 const traceVersion = 1;
+
+TraceHeader makeTraceHeader()
+{
+    TraceHeader header;
+    std::memcpy(header.magic, traceMagic, sizeof(header.magic));
+    header.version = traceVersion;
+    header.recordSize = sizeof(TraceRecord);
+    header.eventSize = sizeof(sf::Event);
+    header.eventTypeCount = sf::Event::Count;
+    header.records = 0;
+    return header;
+}
+
+
+
+// Append-only trace file, written through a memory mapping that grows as needed
+class TraceWriter
+{
+public:
+    ~TraceWriter() { close(); }
+
+    bool open(std::string const& path)
+    {
+        this->path = path;
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1 || !map(4096))
+        {
+            std::cerr << "Cannot create trace " << path << ": " << std::strerror(errno) << std::endl;
+            close();
+            return false;
+        }
+
+        auto const header = makeTraceHeader();
+        std::memcpy(data, &header, sizeof(header));
+        return true;
+    }
+
+    bool isOpen() const { return data != nullptr; }
+
+    void append(sf::Event const& event, sf::Time timestamp)
+    {
+        if (!data)
+            return;
+
+        auto const records = header().records;
+        if (records == capacity && !map(capacity * 2))
+            return;
+
+        TraceRecord const record{ timestamp.asMicroseconds(), event };
+        std::memcpy(data + sizeof(TraceHeader) + records * sizeof(TraceRecord), &record, sizeof(record));
+        header().records = records + 1;
+    }
+
+    // Trim the file to the records actually written
+    void close()
+    {
+        if (data)
+        {
+            auto const size = sizeof(TraceHeader) + header().records * sizeof(TraceRecord);
+            ::munmap(data, sizeof(TraceHeader) + capacity * sizeof(TraceRecord));
+            data = nullptr;
+            if (::ftruncate(fd, size) != 0)
+                std::cerr << "Cannot trim trace " << path << ": " << std::strerror(errno) << std::endl;
+        }
+
+        if (fd != -1)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+private:
+    TraceHeader& header() { return *reinterpret_cast<TraceHeader*>(data); }
+
+    bool map(std::size_t newCapacity)
+    {
+        auto const size = sizeof(TraceHeader) + newCapacity * sizeof(TraceRecord);
+        if (::ftruncate(fd, size) != 0)
+            return false;
+
+        if (data)
+            ::munmap(data, sizeof(TraceHeader) + capacity * sizeof(TraceRecord));
+
+        void* address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        data = address == MAP_FAILED ? nullptr : static_cast<char*>(address);
+        capacity = newCapacity;
+        return data != nullptr;
+    }
+
+private:
+    std::string path;
+    int fd = -1;
+    char* data = nullptr;
+    std::size_t capacity = 0; // in records
+};
+
+
+
+class TraceReader
+{
+public:
+    bool open(std::string const& path)
+    {
+        if (!file.open(path))
+        {
+            std::cerr << "Cannot open trace " << path << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        if (file.size() < sizeof(TraceHeader) || !isValid())
+        {
+            std::cerr << "Invalid or incompatible trace " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    std::size_t size() const
+    {
+        TraceHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        return header.records;
+    }
+
+    TraceRecord operator[](std::size_t index) const
+    {
+        TraceRecord record;
+        std::memcpy(&record, file.data() + sizeof(TraceHeader) + index * sizeof(TraceRecord), sizeof(record));
+        return record;
+    }
+
+private:
+    bool isValid() const
+    {
+        TraceHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        auto const expected = makeTraceHeader();
+        return std::memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0 &&
+               header.version == expected.version && header.recordSize == expected.recordSize &&
+               header.eventSize == expected.eventSize && header.eventTypeCount == expected.eventTypeCount &&
+               header.records <= (file.size() - sizeof(TraceHeader)) / sizeof(TraceRecord);
+    }
+
+private:
+    MappedFile file;
+};
+
+
+
+// Merge the motion events received during a frame: within a run of motion
+// events, all the events of a given device and axis become one, holding the
+// latest value, the accumulated delta and the number of merged events. Any
+// other event ends the run so the relative order of events is preserved.
+class EventCoalescer
+{
+public:
+    struct Entry
+    {
+        sf::Event event;    // latest event; for wheels, delta is the accumulated one
+        sf::Vector2f delta; // mouse: position change, joystick: position change (x only)
+        unsigned int count = 1;
+    };
+
+    EventCoalescer()
+    {
+        for (auto type : { sf::Event::MouseMoved, sf::Event::MouseWheelMoved, sf::Event::MouseWheelScrolled,
+                           sf::Event::JoystickMoved, sf::Event::TouchMoved })
+            enabled[type] = true;
+    }
+
+    static bool isSupported(sf::Event::EventType type)
+    {
+        return type == sf::Event::MouseMoved || type == sf::Event::MouseWheelMoved ||
+               type == sf::Event::MouseWheelScrolled || type == sf::Event::JoystickMoved ||
+               type == sf::Event::TouchMoved;
+    }
+
+    void setEnabled(sf::Event::EventType type, bool enable) { enabled[type] = enable && isSupported(type); }
+
+    void push(sf::Event const& event)
+    {
+        ++received;
+
+        if (!enabled[event.type])
+        {
+            entries.push_back({ event, {}, 1 });
+            runStart = entries.size();
+            return;
+        }
+
+        for (auto i = runStart; i < entries.size(); ++i)
+        {
+            if (sameSource(entries[i].event, event))
+            {
+                merge(entries[i], event);
+                return;
+            }
+        }
+        entries.push_back({ event, {}, 1 });
+    }
+
+    std::vector<Entry> const& events() const { return entries; }
+
+    void clear()
+    {
+        entries.clear();
+        runStart = 0;
+    }
+
+    std::uint64_t receivedEvents() const { return received; }
+
+private:
+    static bool sameSource(sf::Event const& a, sf::Event const& b)
+    {
+        if (a.type != b.type)
+            return false;
+
+        switch (a.type)
+        {
+        default:
+            return true;
+
+        case sf::Event::MouseWheelScrolled:
+            return a.mouseWheelScroll.wheel == b.mouseWheelScroll.wheel;
+
+        case sf::Event::JoystickMoved:
+            return a.joystickMove.joystickId == b.joystickMove.joystickId &&
+                   a.joystickMove.axis == b.joystickMove.axis;
+
+        case sf::Event::TouchMoved:
+            return a.touch.finger == b.touch.finger;
+        }
+    }
+
+    static void merge(Entry& entry, sf::Event const& event)
+    {
+        auto& latest = entry.event;
+        switch (event.type)
+        {
+        default:
+            break;
+
+        case sf::Event::MouseMoved:
+            entry.delta.x += event.mouseMove.x - latest.mouseMove.x;
+            entry.delta.y += event.mouseMove.y - latest.mouseMove.y;
+            latest = event;
+            break;
+
+        case sf::Event::MouseWheelMoved:
+        {
+            auto const delta = latest.mouseWheel.delta + event.mouseWheel.delta;
+            latest = event;
+            latest.mouseWheel.delta = delta;
+            break;
+        }
+
+        case sf::Event::MouseWheelScrolled:
+        {
+            auto const delta = latest.mouseWheelScroll.delta + event.mouseWheelScroll.delta;
+            latest = event;
+            latest.mouseWheelScroll.delta = delta;
+            break;
+        }
+
+        case sf::Event::JoystickMoved:
+            entry.delta.x += event.joystickMove.position - latest.joystickMove.position;
+            latest = event;
+            break;
+
+        case sf::Event::TouchMoved:
+            entry.delta.x += event.touch.x - latest.touch.x;
+            entry.delta.y += event.touch.y - latest.touch.y;
+            latest = event;
+            break;
+        }
+        ++entry.count;
+    }
+
+private:
+    std::array<bool, sf::Event::Count> enabled{};
+    std::vector<Entry> entries;
+    std::size_t runStart = 0; // first entry of the current run of motion events
+    std::uint64_t received = 0;
+};
+
+
+
+// Save frames from a background thread, either as PNG files or as raw RGBA
+// dumps (width * height * 4 bytes, no header), named after the frame index.
+class FrameEncoder
+{
+public:
+    enum class Format
+    {
+        Png,
+        Raw,
+    };
+
+    FrameEncoder(std::string const& directory, Format format)
+        : directory(directory)
+        , format(format)
+        , queue(16)
+        , encoder(&FrameEncoder::run, this)
+    {
+    }
+
+    ~FrameEncoder()
+    {
+        running = false;
+        encoder.join();
+    }
+
+    // Block while the encoder is too far behind
+    void push(sf::Image const& image)
+    {
+        Frame frame{ nextIndex++, image };
+        while (!queue.push(std::move(frame)))
+            std::this_thread::yield();
+    }
+
+private:
+    struct Frame
+    {
+        unsigned int index = 0;
+        sf::Image image;
+    };
+
+    void run()
+    {
+        Frame frame;
+        for (;;)
+        {
+            bool const stopping = !running;
+
+            bool idle = true;
+            while (queue.pop(frame))
+            {
+                save(frame);
+                idle = false;
+            }
+
+            if (idle && stopping)
+                break;
+
+            if (idle)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    void save(Frame const& frame) const
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "/frame%06u", frame.index);
+        auto const path = directory + name;
+
+        if (format == Format::Png)
+        {
+            frame.image.saveToFile(path + ".png");
+        }
+        else
+        {
+            auto const size = frame.image.getSize();
+            std::ofstream out(path + ".rgba", std::ios::binary);
+            out.write(reinterpret_cast<char const*>(frame.image.getPixelsPtr()), size.x * size.y * 4);
+        }
+    }
+
+private:
+    std::string directory;
+    Format format;
+    unsigned int nextIndex = 0;
+    SpscQueue<Frame> queue;
+    std::atomic<bool> running{ true };
+    std::thread encoder; // last, so it starts once everything else is ready
+};
+
+
+
+// Histogram of durations in microseconds with a bounded relative error, in
+// the spirit of HdrHistogram: values below 64 have their own bucket, larger
+// ones share a bucket with the values having the same 6 leading bits.
+class Histogram
+{
+public:
+    void record(sf::Int64 value)
+    {
+        value = std::max<sf::Int64>(value, 0);
+        ++buckets[indexOf(value)];
+        ++total;
+        sum += value;
+        minimum = total == 1 ? value : std::min(minimum, value);
+        maximum = std::max(maximum, value);
+    }
+
+    // Highest value of the bucket holding the given percentile, in [0, 100]
+    sf::Int64 percentile(double p) const
+    {
+        if (total == 0)
+            return 0;
+
+        auto const rank = static_cast<std::uint64_t>(std::ceil(p / 100 * total));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < buckets.size(); ++i)
+        {
+            seen += buckets[i];
+            if (seen >= std::max<std::uint64_t>(rank, 1))
+                return std::min(upperBound(i), maximum);
+        }
+        return maximum;
+    }
+
+    std::uint64_t count() const { return total; }
+    sf::Int64 min() const { return minimum; }
+    sf::Int64 max() const { return maximum; }
+    double mean() const { return total == 0 ? 0 : static_cast<double>(sum) / total; }
+
+    // Call f(lowestValue, count) for each non-empty bucket
+    template <class F>
+    void forEachBucket(F f) const
+    {
+        for (std::size_t i = 0; i < buckets.size(); ++i)
+            if (buckets[i] > 0)
+                f(lowerBound(i), buckets[i]);
+    }
+
+private:
+    static std::size_t indexOf(sf::Int64 value)
+    {
+        if (value < 64)
+            return value;
+
+        std::size_t shift = 0;
+        while ((value >> shift) >= 64)
+            ++shift;
+        return shift * 32 + (value >> shift);
+    }
+
+    static sf::Int64 lowerBound(std::size_t index)
+    {
+        if (index < 64)
+            return index;
+
+        auto const shift = (index - 32) / 32;
+        auto const mantissa = index - shift * 32;
+        return static_cast<sf::Int64>(mantissa) << shift;
+    }
+
+    static sf::Int64 upperBound(std::size_t index) { return lowerBound(index + 1) - 1; }
+
+private:
+    std::array<std::uint64_t, 64 * 32> buckets{};
+    std::uint64_t total = 0;
+    sf::Int64 sum = 0;
+    sf::Int64 minimum = 0;
+    sf::Int64 maximum = 0;
+};
+
+
+
+// Time spent in each phase of the main loop, and how long events wait
+// before being handled. SFML events carry no OS timestamp, so the latency of
+// an event is measured from the moment the loop starts draining the queue.
+class FrameStats
+{
+public:
+    enum Phase
+    {
+        EventDrain,
+        JoystickUpdate,
+        Draw,
+        Display,
+        Frame,
+        EventLatency,
+        Idle,
+        PhaseCount
+    };
+
+    static char const* name(Phase phase)
+    {
+        static char const* const names[PhaseCount] = {
+            "event drain", "joystick update", "draw", "display", "frame", "event latency", "idle",
+        };
+        return names[phase];
+    }
+
+    void beginFrame()
+    {
+        frameClock.restart();
+        phaseClock.restart();
+    }
+
+    // Record the time elapsed since the previous phase ended
+    void endPhase(Phase phase) { histograms[phase].record(phaseClock.restart().asMicroseconds()); }
+
+    void endFrame() { histograms[Frame].record(frameClock.getElapsedTime().asMicroseconds()); }
+
+    // To be called once an event is handled, during the EventDrain phase
+    void eventHandled() { histograms[EventLatency].record(phaseClock.getElapsedTime().asMicroseconds()); }
+
+    void reset() { histograms.fill(Histogram()); }
+
+    Histogram const& operator[](Phase phase) const { return histograms[phase]; }
+
+    // CSV if the path ends with .csv, JSON otherwise
+    bool save(std::string const& path) const
+    {
+        std::ofstream out(path);
+        bool const csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+
+        if (csv)
+            out << "phase,count,min_us,mean_us,p50_us,p90_us,p99_us,max_us\n";
+        else
+            out << "{\n";
+
+        for (int i = 0; i < PhaseCount; ++i)
+        {
+            auto const phase = static_cast<Phase>(i);
+            auto const& h = histograms[phase];
+
+            if (csv)
+            {
+                out << name(phase) << "," << h.count() << "," << h.min() << "," << h.mean() << ","
+                    << h.percentile(50) << "," << h.percentile(90) << "," << h.percentile(99) << ","
+                    << h.max() << "\n";
+                continue;
+            }
+
+            out << "  \"" << name(phase) << "\": {\"count\": " << h.count() << ", \"min_us\": " << h.min()
+                << ", \"mean_us\": " << h.mean() << ", \"p50_us\": " << h.percentile(50)
+                << ", \"p90_us\": " << h.percentile(90) << ", \"p99_us\": " << h.percentile(99)
+                << ", \"max_us\": " << h.max() << ", \"buckets\": [";
+            char const* separator = "";
+            h.forEachBucket([&](sf::Int64 value, std::uint64_t count) {
+                out << separator << "[" << value << ", " << count << "]";
+                separator = ", ";
+            });
+            out << "]}" << (i + 1 < PhaseCount ? ",\n" : "\n");
+        }
+
+        if (!csv)
+            out << "}\n";
+
+        return static_cast<bool>(out);
+    }
+
+private:
+    std::array<Histogram, PhaseCount> histograms;
+    sf::Clock frameClock;
+    sf::Clock phaseClock;
+};
+
+
+
+// p50/p99/max of each phase under a title, refreshed a couple of times per
+// second
+class StatsOverlay : public sf::Drawable, public sf::Transformable
+{
+public:
+    StatsOverlay(sf::Font const& font, unsigned int fontSize)
+        : font(font)
+        , fontSize(fontSize)
+    {
+    }
+
+    void update(FrameStats const& stats, std::string_view title)
+    {
+        if (!vertices.empty() && refreshClock.getElapsedTime() < sf::milliseconds(500))
+            return;
+        refreshClock.restart();
+        ++revision;
+
+        vertices.clear();
+        float width = appendText(vertices, font, fontSize, title, sf::Color::Cyan, { 0, 0 }).x;
+        float y = fontSize * 1.1f;
+        for (int i = 0; i < FrameStats::PhaseCount; ++i)
+        {
+            auto const phase = static_cast<FrameStats::Phase>(i);
+            auto const& h = stats[phase];
+
+            char line[128];
+            std::snprintf(line, sizeof(line), "%-17s p50 %6lld p99 %6lld max %7lld us", FrameStats::name(phase),
+                          static_cast<long long>(h.percentile(50)), static_cast<long long>(h.percentile(99)),
+                          static_cast<long long>(h.max()));
+
+            width = std::max(width, appendText(vertices, font, fontSize, std::string_view(line), sf::Color::Cyan,
+                                               { 0, y }).x);
+            y += fontSize * 1.1f;
+        }
+
+        background.setSize({ width + 10, y + 10 });
+        background.setPosition(-5, -5);
+        background.setFillColor(sf::Color(0, 0, 0, 192));
+    }
+
+    sf::Vector2f getSize() const { return background.getSize() - sf::Vector2f(10, 10); }
+
+    // Changes whenever the drawn content does
+    std::uint64_t getRevision() const { return revision; }
+
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override
+    {
+        states.transform *= getTransform();
+        target.draw(background, states);
+        states.texture = &font.getTexture(fontSize);
+        target.draw(vertices.data(), vertices.size(), sf::Triangles, states);
+    }
+
+private:
+    sf::Font const& font;
+    unsigned int fontSize;
+    std::vector<sf::Vertex> vertices;
+    sf::RectangleShape background;
+    sf::Clock refreshClock;
+    std::uint64_t revision = 0;
+};
+
+
+
+// How long window mode switches take, from the request until the first
+// frame in the new mode is presented, and how much of it creating the window
+// again takes when it has to be
+class ModeSwitchStats
+{
+public:
+    void begin()
+    {
+        clock.restart();
+        pending = true;
+    }
+
+    void created() { create.record(clock.getElapsedTime().asMicroseconds()); }
+
+    // Call once a frame is presented
+    void presented()
+    {
+        if (!pending)
+            return;
+        total.record(clock.getElapsedTime().asMicroseconds());
+        pending = false;
+    }
+
+    std::uint64_t count() const { return total.count(); }
+
+    void report(std::ostream& out) const
+    {
+        out << "Window mode switches: " << total.count() << " (" << create.count() << " recreating the window)\n"
+            << "\tcreate: p50 " << create.percentile(50) << " us, p99 " << create.percentile(99) << " us, max "
+            << create.max() << " us\n"
+            << "\tto first frame: p50 " << total.percentile(50) << " us, p99 " << total.percentile(99)
+            << " us, max " << total.max() << " us" << std::endl;
+    }
+
+private:
+    sf::Clock clock;
+    bool pending = false;
+    Histogram create;
+    Histogram total;
+};
+
+// How the main loop paces its frames
+enum class Pacing
+{
+    Fixed,       // at most framerateLimit frames per second, slept in display()
+    VSync,       // display() waits for the vertical refresh
+    EventDriven, // no limit, but block waiting for events while idle
+    Uncapped,    // never sleep, for the lowest latency
+    Count
+};
+
+constexpr std::array<char const*, static_cast<std::size_t>(Pacing::Count)> pacingNames = {
+    "fixed", "vsync", "event", "uncapped",
+};
+
+std::string_view pacing2string(Pacing pacing) { return pacingNames[static_cast<std::size_t>(pacing)]; }
+
+std::optional<Pacing> string2pacing(std::string_view name)
+{
+    for (std::size_t i = 0; i < pacingNames.size(); ++i)
+        if (name == pacingNames[i])
+            return static_cast<Pacing>(i);
+    return std::nullopt;
+}
+
+// What a key binding does. The actions up to ShrinkGrid only change what is
+// displayed. Those up to PasteText drive the history view and the text input;
+// they trigger when the key is pressed, so that they repeat while it is held.
+// The others act on the window or the OS.
+enum class Action : std::uint8_t
+{
+    None,
+    ToggleJoystickTable,
+    ToggleStats,
+    ToggleTextInput,
+    NextPacing,
+    EnlargeGrid,
+    ShrinkGrid,
+    HistoryOlder,
+    HistoryNewer,
+    HistoryLatest,
+    HistoryTypeFilter,
+    HistoryKeyFilter,
+    CursorLeft,
+    CursorRight,
+    PasteText,
+    ToggleGrab,
+    ArrowCursor,
+    CrossCursor,
+    HandCursor,
+    IconCursor,
+    Close,
+    Fullscreen,
+    Windowed,
+    WarpMouse,        // to (100, 100) in the window
+    WarpMouseDesktop, // to (100, 100) on the desktop
+    LogPosition,
+    MoveWindow,
+    LogDesktopMode,
+    LogSize,
+    ResizeWindow,
+    PasteClipboard,
+    CopyClipboard,
+    Count
+};
+
+constexpr std::array<char const*, static_cast<std::size_t>(Action::Count)> actionNames = {
+    "none",          "toggle-joystick-table", "toggle-stats",       "toggle-text-input",
+    "next-pacing",   "enlarge-grid",          "shrink-grid",        "history-older",
+    "history-newer", "history-latest",        "history-type-filter", "history-key-filter",
+    "cursor-left",   "cursor-right",          "paste-text",         "toggle-grab",
+    "arrow-cursor",  "cross-cursor",          "hand-cursor",        "icon-cursor",
+    "close",         "fullscreen",            "windowed",           "warp-mouse",
+    "warp-mouse-desktop", "log-position",     "move-window",        "log-desktop-mode",
+    "log-size",      "resize-window",         "paste-clipboard",    "copy-clipboard",
+};
+
+std::string_view action2string(Action action) { return actionNames[static_cast<std::size_t>(action)]; }
+
+std::optional<Action> string2action(std::string_view name)
+{
+    for (std::size_t i = 0; i < actionNames.size(); ++i)
+        if (name == actionNames[i])
+            return static_cast<Action>(i);
+    return std::nullopt;
+}
+
+bool isViewAction(Action action) { return action >= Action::HistoryOlder && action <= Action::PasteText; }
+
+bool isTextAction(Action action) { return action >= Action::CursorLeft && action <= Action::PasteText; }
+
+bool isWindowAction(Action action) { return action >= Action::ToggleGrab && action < Action::Count; }
+
+// Bindings used unless --bindings is given, in the format of that file
+constexpr char const defaultBindings[] = R"(# Display
+J           toggle-joystick-table
+T           toggle-stats
+Insert      toggle-text-input
+R           next-pacing
+Add         enlarge-grid
+Subtract    shrink-grid
+
+# History view and text input, repeated while the key is held
+PageUp      history-older
+PageDown    history-newer
+End         history-latest
+F1          history-type-filter
+F2          history-key-filter
+Left        cursor-left
+Right       cursor-right
+Control+V   paste-text
+
+# Window and OS
+G           toggle-grab
+Num1        arrow-cursor
+Num2        cross-cursor
+Num3        hand-cursor
+Num4        icon-cursor
+Escape      close
+F           fullscreen
+N           windowed
+P           warp-mouse
+Q           warp-mouse-desktop
+A           log-position
+Shift+A     move-window
+B           log-desktop-mode
+C           log-size
+Shift+C     resize-window
+System+V    paste-clipboard
+System+C    copy-clipboard
+)";
+
+
+
+namespace
+{
+    int windowCount = 0;
+    sf::VideoMode windowMode;
+    sf::Uint32 windowStyle = sf::Style::None;
+    ModeSwitchStats modeSwitches;
+    bool fastModeSwitch = false; // resize rather than re-create when possible
+    bool grabbed = false;
+    bool displayJoystickTable = false;
+    bool displayStats = false;
+    bool textInput = false; // keys type text instead of triggering actions
+    std::size_t gridSize = 50;
+    unsigned int const framerateLimit = 30;
+    Pacing pacing = Pacing::Fixed;
+
+    sf::Event::EventType lastType = sf::Event::Count;
+    std::map<sf::Joystick::Axis, sf::Clock> axisClocks;
+}
+
+
+
+// Lay out the window count in the center of `target`, like an sf::Text would
+void appendWindowCount(TextBatch& text, sf::RenderTarget const& target, sf::Font const& font)
+{
+    char digits[16];
+    auto const end = std::to_chars(digits, std::end(digits), windowCount).ptr;
+    auto const pos = target.getSize() / 2u;
+    appendText(text.layer(font.getTexture(30)), font, 30, std::string_view(digits, end - digits),
+               sf::Color::Yellow, static_cast<sf::Vector2f>(pos));
+}
+
+void applyPacing(sf::Window& window)
+{
+    window.setVerticalSyncEnabled(pacing == Pacing::VSync);
+    window.setFramerateLimit(pacing == Pacing::Fixed ? framerateLimit : 0);
+}
+
+// How long a frame that is not drawn should last, so that idle frames come at
+// the pace of drawn ones. Event-driven pacing waits for the next event instead.
+sf::Time idleFrameTime()
+{
+    switch (pacing)
+    {
+    case Pacing::Fixed:
+        return sf::seconds(1.f / framerateLimit);
+    case Pacing::VSync:
+        return sf::seconds(1.f / 60); // SFML does not tell the refresh rate
+    default:
+        return sf::Time::Zero;
+    }
+}
+
+// Polling updates the joystick states, which the joystick sampler reads
+bool pollEvent(sf::Window& window, sf::Event& event)
+{
+    std::lock_guard<std::mutex> lock(joystickMutex);
+    return window.pollEvent(event);
+}
+
+// SFML 2.5 has no waitEvent() with a timeout: poll, sleeping 1 ms between
+// attempts, which is what waitEvent() does too (with 10 ms).
+bool waitEvent(sf::Window& window, sf::Event& event, sf::Time timeout)
+{
+    sf::Clock clock;
+    while (!pollEvent(window, event))
+    {
+        if (clock.getElapsedTime() >= timeout)
+            return false;
+        sf::sleep(sf::milliseconds(1));
+    }
+    return true;
+}
+
+// User and system time used by the process so far
+sf::Time cpuTime()
+{
+    rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return sf::seconds(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           sf::microseconds(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+void createWindow(sf::Window& window, sf::VideoMode const& mode, sf::Uint32 style)
+{
+    ++windowCount;
+    grabbed = false;
+
+    window.create(mode, "SFML Window", style);
+    applyPacing(window);
+
+    std::cout << "New window:\n"
+              << "\tsize: " << window.getSize()
+              << "\trequested: " << sf::Vector2u(mode.width, mode.height) << "\n" << std::endl;
+}
+
+// SFML 2.5 can only change the style of a window by creating it again, along
+// with its GL context. Textures, glyph atlases and vertex buffers survive it
+// since every SFML context shares its objects with an internal one. The window
+// is always created again unless fastModeSwitch is set: a window keeping its
+// style is then only resized, and left alone if it is already in the
+// requested fullscreen mode.
+void setWindowMode(sf::RenderWindow& window, sf::VideoMode const& mode, sf::Uint32 style)
+{
+    bool const open = window.isOpen();
+    bool const keepStyle = fastModeSwitch && open && style == windowStyle;
+    if (keepStyle && style == sf::Style::Fullscreen && mode == windowMode)
+        return;
+
+    if (open)
+        modeSwitches.begin();
+
+    if (keepStyle)
+    {
+        window.setSize({ mode.width, mode.height });
+        window.setView(sf::View(sf::FloatRect(0, 0, mode.width, mode.height)));
+    }
+    else
+    {
+        createWindow(window, mode, style);
+        if (open)
+            modeSwitches.created();
+    }
+
+    windowMode = mode;
+    windowStyle = style;
+}
+
+void goWindowed(sf::RenderWindow& window)
+{
+    setWindowMode(window, sf::VideoMode(800, 600), sf::Style::Default);
+}
+
+void goFullscreen(sf::RenderWindow& window)
+{
+    setWindowMode(window, sf::VideoMode::getDesktopMode(), sf::Style::Fullscreen);
+}
+
+void drawBorder(sf::RenderTarget& target)
+{
+    sf::RectangleShape borders{ static_cast<sf::Vector2f>(target.getSize()) };
+    borders.setFillColor(sf::Color::Transparent);
+    borders.setOutlineColor(sf::Color::White);
+    borders.setOutlineThickness(-20);
+    target.draw(borders);
+}
+
+// Grid geometry for each cell size, built once per target size and kept in a
+// static vertex buffer when the GPU supports it. The buffer is shared by all
+// GL contexts, so it survives the window being created again.
+class GridCache
+{
+public:
+    void draw(sf::RenderTarget& target, std::size_t size)
+    {
+        auto& grid = grids[size];
+        if (grid.targetSize != target.getSize())
+            build(grid, target.getSize(), size);
+
+        if (grid.buffer.getVertexCount() > 0)
+            target.draw(grid.buffer);
+        else
+            target.draw(grid.vertices);
+    }
+
+private:
+    struct Grid
+    {
+        sf::Vector2u targetSize;
+        sf::VertexBuffer buffer{ sf::Lines, sf::VertexBuffer::Static };
+        sf::VertexArray vertices{ sf::Lines }; // when vertex buffers are not available
+    };
+
+    void build(Grid& grid, sf::Vector2u targetSize, std::size_t size)
+    {
+        grid.targetSize = targetSize;
+
+        float const h = targetSize.y;
+        float const w = targetSize.x;
+
+        vertexes.clear();
+        for (float y = 0.f; y <= h; y += size) {
+            vertexes.push_back(sf::Vertex({0, y-1}, sf::Color::Green));
+            vertexes.push_back(sf::Vertex({w, y-1}, sf::Color::Green));
+            vertexes.push_back(sf::Vertex({0, y}, sf::Color::Green));
+            vertexes.push_back(sf::Vertex({w, y}, sf::Color::Green));
+            vertexes.push_back(sf::Vertex({0, y+1}, sf::Color::Green));
+            vertexes.push_back(sf::Vertex({w, y+1}, sf::Color::Green));
+        }
+
+        for (float x = 0.f; x <= w; x += size) {
+            vertexes.push_back(sf::Vertex({x-1, 0}, sf::Color::Green));
+            vertexes.push_back(sf::Vertex({x-1, h}, sf::Color::Green));
+            vertexes.push_back(sf::Vertex({x, 0}, sf::Color::Green));
+            vertexes.push_back(sf::Vertex({x, h}, sf::Color::Green));
+            vertexes.push_back(sf::Vertex({x+1, 0}, sf::Color::Green));
+            vertexes.push_back(sf::Vertex({x+1, h}, sf::Color::Green));
+        }
+
+        grid.vertices.clear();
+        if (sf::VertexBuffer::isAvailable() && grid.buffer.create(vertexes.size()) &&
+            grid.buffer.update(vertexes.data()))
+            return;
+
+        grid.buffer = sf::VertexBuffer{ sf::Lines, sf::VertexBuffer::Static };
+        for (auto const& vertex : vertexes)
+            grid.vertices.append(vertex);
+    }
+
+private:
+    std::map<std::size_t, Grid> grids;
+    std::vector<sf::Vertex> vertexes; // scratch buffer reused between builds
+};
+
+sf::CircleShape makeCursorShape()
+{
+    sf::CircleShape cursorShape;
+    cursorShape.setRadius(20.f);
+    cursorShape.setOrigin(20.f, 20.f);
+    cursorShape.setFillColor(sf::Color::Red);
+    return cursorShape;
+}
+
+// Draw the logger/joystick table, window count and border
+// All the text is drawn through `text`, with one call per character size. The
+// history, if given, replaces the logger while scrolled back or filtered, and
+// the text input, if given, replaces both while text input is on.
+void drawScene(sf::RenderTarget& target, sf::Font const& font, TextBatch& text, GraphicLogger const& logger,
+               JoystickTable const& joyInfo, HistoryView const* history = nullptr,
+               InputPanel const* input = nullptr)
+{
+    text.clear();
+    if (displayJoystickTable)
+        joyInfo.appendTo(text);
+    else if (input && textInput)
+        input->appendTo(text);
+    else if (history && history->isActive())
+        history->appendTo(text);
+    else
+        logger.appendTo(text);
+    appendWindowCount(text, target, font);
+    target.draw(text);
+
+    drawBorder(target);
+}
+
+// Tell whether a frame has to be drawn. What is on screen depends on the
+// content of the drawables, tracked by their revision, and on a few states
+// read while drawing; a frame is drawn only if any of them changed since the
+// last frame drawn. Since SFML reports no expose event, and some window
+// systems do not keep the content of a covered window, a frame is drawn at
+// least every second anyway.
+class DamageTracker
+{
+public:
+    struct State
+    {
+        std::uint64_t content = 0; // revision of the logger, history, text input or joystick table
+        bool joystickTable = false;
+        bool history = false;
+        bool textInput = false;
+        int windowCount = 0;
+        sf::Vector2u size;
+        bool grid = false;
+        std::size_t gridSize = 0;
+        bool cursor = false;
+        sf::Vector2f cursorPosition;
+        std::uint64_t overlay = 0; // revision of the timing overlay, 0 if hidden
+
+        bool operator==(State const& other) const
+        {
+            return content == other.content && joystickTable == other.joystickTable && history == other.history &&
+                   textInput == other.textInput && windowCount == other.windowCount && size == other.size &&
+                   grid == other.grid && gridSize == other.gridSize && cursor == other.cursor &&
+                   cursorPosition == other.cursorPosition && overlay == other.overlay;
+        }
+    };
+
+    explicit DamageTracker(bool enabled) : enabled(enabled) {}
+
+    bool isDamaged(State const& state)
+    {
+        bool const damaged = !enabled || !drawn || !(state == last) ||
+                             refreshClock.getElapsedTime() >= sf::seconds(1);
+        if (damaged)
+        {
+            last = state;
+            drawn = true;
+            refreshClock.restart();
+        }
+        else
+        {
+            ++skipped;
+        }
+        return damaged;
+    }
+
+    std::uint64_t skippedFrames() const { return skipped; }
+
+private:
+    bool enabled;
+    bool drawn = false;
+    State last;
+    sf::Clock refreshClock;
+    std::uint64_t skipped = 0;
+};
+
+void printVideoModes()
+{
+    std::cout << "Fullscreen modes:\n";
+    for (auto mode : sf::VideoMode::getFullscreenModes()) {
+        std::cout << "\t" << mode.width << "x" << mode.height << "\n";
+    }
+    auto desktop = sf::VideoMode::getDesktopMode();
+    std::cout << "Desktop mode:\n\t" << desktop.width << "x" << desktop.height << "\n";
+}
+
+// Log events
+#define LOGEvent(type)                                                                             \
+    case sf::Event::type:                                                                          \
+        logger.log(LogRecord::text(#type))
+
+#define LOGXY(var) logger.log(LogRecord::pair(#var, var.x, var.y))
+
+#define LOGWheel(var) logger.log(LogRecord::delta(#var, var.delta))
+
+#define LOGWidthHeight(var) logger.log(LogRecord::pair(#var, var.width, var.height))
+
+#define LOGKey(var) logger.log(LogRecord::key(var.key.code, var.type == sf::Event::KeyPressed))
+
+#define LOGButton(var)                                                                             \
+    logger.log(LogRecord::button(var.mouseButton.button, var.type == sf::Event::MouseButtonPressed))
+
+// Motion events merged by the coalescer: how many, and the change of position
+void logMerged(GraphicLogger& logger, EventCoalescer::Entry const& entry)
+{
+    if (entry.count < 2)
+        return;
+
+    logger.log(LogRecord::integer("\tmerged events: ", static_cast<int>(entry.count)));
+    if (entry.event.type == sf::Event::MouseMoved)
+        logger.log(LogRecord::pair("\tmerged", static_cast<int>(entry.delta.x), static_cast<int>(entry.delta.y)));
+    else if (entry.event.type == sf::Event::JoystickMoved)
+        logger.log(LogRecord::delta("\tmerged", entry.delta.x));
+}
+
+void logEvent(GraphicLogger& logger, JoystickTable& joyInfo, EventCoalescer::Entry const& entry)
+{
+    auto const& event = entry.event;
+    bool const keyEvent = event.type == sf::Event::KeyPressed || event.type == sf::Event::KeyReleased;
+    logger.setSource(event.type, keyEvent ? event.key.code : sf::Keyboard::Unknown);
+
+    if (event.type != sf::Event::MouseMoved || lastType != sf::Event::MouseMoved)
+        switch (event.type)
+        {
+            LOGEvent(Closed);
+            break;
+
+            LOGEvent(Resized);
+            LOGWidthHeight(event.size);
+            break;
+
+            LOGEvent(LostFocus);
+            break;
+
+            LOGEvent(GainedFocus);
+            break;
+
+            LOGEvent(TextEntered);
+            logger.log(LogRecord::codePoint("\tunicode: ", event.text.unicode));
+            break;
+
+            LOGEvent(KeyPressed);
+            LOGKey(event);
+            break;
+
+            LOGEvent(KeyReleased);
+            LOGKey(event);
+            break;
+
+            LOGEvent(MouseButtonPressed);
+            LOGButton(event);
+            LOGXY(event.mouseButton);
+            break;
+
+            LOGEvent(MouseButtonReleased);
+            LOGButton(event);
+            LOGXY(event.mouseButton);
+            break;
+
+            LOGEvent(MouseMoved);
+            LOGXY(event.mouseMove);
+            logMerged(logger, entry);
+            break;
+
+            LOGEvent(MouseWheelMoved);
+            LOGWheel(event.mouseWheel);
+            LOGXY(event.mouseWheel);
+            logMerged(logger, entry);
+            break;
+
+            LOGEvent(MouseWheelScrolled);
+            LOGWheel(event.mouseWheelScroll);
+            LOGXY(event.mouseWheelScroll);
+            logger.log(LogRecord::text(event.mouseWheelScroll.wheel == sf::Mouse::VerticalWheel
+                                           ? "VerticalWheel"
+                                           : "HorizontalWheel"));
+            logMerged(logger, entry);
+            break;
+
+            LOGEvent(MouseEntered);
+            break;
+
+            LOGEvent(MouseLeft);
+            break;
+
+            LOGEvent(JoystickButtonPressed);
+            break;
+
+            LOGEvent(JoystickButtonReleased);
+            break;
+
+            LOGEvent(JoystickMoved);
+            if (axisClocks[event.joystickMove.axis].getElapsedTime() > sf::seconds(2)) {
+                logger.log(LogRecord::integer("\tid:", event.joystickMove.joystickId));
+                logger.log(LogRecord::real("\tposition:", event.joystickMove.position));
+                logger.log(LogRecord::axis("\taxis:", event.joystickMove.axis));
+                logMerged(logger, entry);
+                axisClocks[event.joystickMove.axis].restart();
+            }
+            break;
+
+            LOGEvent(JoystickConnected);
+            joyInfo.setJoystick(event.joystickConnect.joystickId);
+            break;
+
+            LOGEvent(JoystickDisconnected);
+            break;
+
+        default:
+            break;
+        }
+    lastType = event.type;
+
+    logger.setSource(sf::Event::Count, sf::Keyboard::Unknown);
+}
+
+// Notice when a file is written or replaced, e.g. by an editor saving it
+// under a temporary name then renaming it. On Linux a thread waits on inotify
+// so that checking for changes costs no system call; elsewhere the thread
+// compares the modification time, size and inode of the file 4 times a second.
+class FileWatcher
+{
+public:
+    FileWatcher() = default;
+    FileWatcher(FileWatcher const&) = delete;
+    FileWatcher& operator=(FileWatcher const&) = delete;
+
+    ~FileWatcher()
+    {
+        running = false;
+        if (watcher.joinable())
+            watcher.join();
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    bool watch(std::string const& path)
+    {
+#ifdef __linux__
+        auto const slash = path.rfind('/');
+        auto const directory = slash == std::string::npos ? std::string(".") : path.substr(0, slash + 1);
+        name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+        fd = ::inotify_init1(IN_CLOEXEC);
+        if (fd < 0 || ::inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+        {
+            std::cerr << "Cannot watch " << path << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+#else
+        name = path;
+        if (!stamp(last))
+        {
+            std::cerr << "Cannot watch " << path << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+#endif
+
+        watcher = std::thread(&FileWatcher::run, this);
+        return true;
+    }
+
+    // Whether the file changed since the last call
+    bool changed() { return modified.exchange(false, std::memory_order_relaxed); }
+
+private:
+#ifdef __linux__
+    void run()
+    {
+        alignas(inotify_event) char buffer[4096];
+        while (running)
+        {
+            pollfd request{ fd, POLLIN, 0 };
+            if (::poll(&request, 1, 250) <= 0)
+                continue;
+
+            auto const size = ::read(fd, buffer, sizeof(buffer));
+            for (ssize_t offset = 0; offset < size;)
+            {
+                auto const* event = reinterpret_cast<inotify_event const*>(buffer + offset);
+                if (event->len > 0 && name == event->name)
+                    modified = true;
+                offset += sizeof(inotify_event) + event->len;
+            }
+        }
+    }
+#else
+    struct Stamp
+    {
+        time_t time;
+        off_t size;
+        ino_t inode;
+
+        bool operator!=(Stamp const& other) const
+        {
+            return time != other.time || size != other.size || inode != other.inode;
+        }
+    };
+
+    bool stamp(Stamp& result) const
+    {
+        struct stat status;
+        if (::stat(name.c_str(), &status) != 0)
+            return false;
+
+        result = Stamp{ status.st_mtime, status.st_size, status.st_ino };
+        return true;
+    }
+
+    // A missing file is being replaced: wait for the new one
+    void run()
+    {
+        while (running)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+            Stamp current;
+            if (stamp(current) && current != last)
+            {
+                last = current;
+                modified = true;
+            }
+        }
+    }
+
+    Stamp last{};
+#endif
+
+private:
+    int fd = -1;
+    std::string name; // file name on Linux, path elsewhere
+    std::atomic<bool> modified{ false };
+    std::atomic<bool> running{ true };
+    std::thread watcher;
+};
+
+// Actions bound to keys, looked up in flat tables indexed by key and
+// modifiers. Each line of a bindings file binds a key, with any of the
+// Alt, Control, Shift and System modifiers (e.g. `Shift+A`), to an action.
+// Several keys separated by spaces form a chord, typed one after the other
+// (e.g. `Control+K G`). Every chord prefix has its own table. Bindings
+// trigger when the key is released, except those of the history view and
+// the text input which trigger when it is pressed, and `#` starts a comment.
+class KeyBindings
+{
+public:
+    KeyBindings() { parse(defaultBindings, "default bindings"); }
+
+    // Use the bindings of `path`, and again whenever it changes
+    bool load(std::string const& path)
+    {
+        if (!read(path))
+            return false;
+
+        this->path = path;
+        watcher = std::make_unique<FileWatcher>();
+        return watcher->watch(path);
+    }
+
+    // Read the bindings file again if it changed. Keeps the current bindings
+    // if the new ones are invalid.
+    bool reload() { return watcher && watcher->changed() && read(path); }
+
+    // Action bound to the key pressed or released by `event`, if any. The
+    // keys starting a chord, and those ending no chord, give Action::None.
+    Action dispatch(sf::Event const& event)
+    {
+        if ((event.type != sf::Event::KeyPressed && event.type != sf::Event::KeyReleased) || event.key.code < 0 ||
+            event.key.code >= sf::Keyboard::KeyCount)
+            return Action::None;
+
+        // Modifiers are pressed and released between the keys of a chord
+        if (table != 0 && isModifier(event.key.code))
+            return Action::None;
+
+        // View actions trigger on (repeated) presses, the others on releases
+        auto const& binding = bindings[index(table, event.key.code, modifiers(event.key))];
+        if ((event.type == sf::Event::KeyPressed) != isViewAction(binding.action))
+            return Action::None;
+
+        table = binding.next;
+        return binding.action;
+    }
+
+private:
+    enum Modifier
+    {
+        Alt = 1,
+        Control = 2,
+        Shift = 4,
+        System = 8,
+        ModifierCount = 16 // combinations
+    };
+
+    struct Binding
+    {
+        Action action = Action::None;
+        std::uint16_t next = 0; // table of the rest of the chord, if any
+    };
+
+    static constexpr std::size_t tableSize = sf::Keyboard::KeyCount * ModifierCount;
+
+    static std::size_t index(std::size_t table, sf::Keyboard::Key key, unsigned int modifiers)
+    {
+        return table * tableSize + key * ModifierCount + modifiers;
+    }
+
+    static unsigned int modifiers(sf::Event::KeyEvent const& key)
+    {
+        return (key.alt ? Alt : 0) | (key.control ? Control : 0) | (key.shift ? Shift : 0) |
+               (key.system ? System : 0);
+    }
+
+    static bool isModifier(sf::Keyboard::Key key)
+    {
+        return key == sf::Keyboard::LAlt || key == sf::Keyboard::RAlt || key == sf::Keyboard::LControl ||
+               key == sf::Keyboard::RControl || key == sf::Keyboard::LShift || key == sf::Keyboard::RShift ||
+               key == sf::Keyboard::LSystem || key == sf::Keyboard::RSystem;
+    }
+
+    bool read(std::string const& path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cerr << "Cannot read key bindings from " << path << std::endl;
+            return false;
+        }
+
+        std::stringstream text;
+        text << file.rdbuf();
+        return parse(text.str(), path);
+    }
+
+    // Replace the bindings by those of `text`, unless it has errors
+    bool parse(std::string const& text, std::string const& source)
+    {
+        std::vector<Binding> parsed(tableSize);
+        std::istringstream lines(text);
+        std::string line;
+        bool valid = true;
+        for (int number = 1; std::getline(lines, line); ++number)
+        {
+            auto const error = [&](std::string const& message) {
+                std::cerr << source << ":" << number << ": " << message << std::endl;
+                valid = false;
+            };
+
+            std::istringstream tokens(line.substr(0, line.find('#')));
+            std::vector<std::string> words{ std::istream_iterator<std::string>(tokens), {} };
+            if (words.empty())
+                continue;
+            if (words.size() < 2)
+            {
+                error("expected keys then an action");
+                continue;
+            }
+
+            auto const action = string2action(words.back());
+            if (!action)
+            {
+                error("unknown action " + words.back());
+                continue;
+            }
+
+            // Walk down the chord, adding the tables of its prefixes
+            std::size_t table = 0;
+            for (std::size_t i = 0; i + 1 < words.size(); ++i)
+            {
+                auto const stroke = parseStroke(words[i]);
+                if (!stroke)
+                {
+                    error("invalid key " + words[i]);
+                    break;
+                }
+
+                auto& binding = parsed[index(table, stroke->first, stroke->second)];
+                bool const last = i + 2 == words.size();
+                if (binding.action != Action::None || (last && binding.next != 0))
+                {
+                    error("conflicting binding for " + words[i]);
+                    break;
+                }
+
+                if (last)
+                {
+                    binding.action = *action;
+                }
+                else
+                {
+                    if (binding.next == 0)
+                    {
+                        binding.next = static_cast<std::uint16_t>(parsed.size() / tableSize);
+                        parsed.resize(parsed.size() + tableSize);
+                    }
+                    table = parsed[index(table, stroke->first, stroke->second)].next;
+                }
+            }
+        }
+
+        if (!valid)
+            return false;
+
+        bindings = std::move(parsed);
+        table = 0;
+        return true;
+    }
+
+    // `Shift+Control+K` gives K and the Shift and Control modifiers
+    static std::optional<std::pair<sf::Keyboard::Key, unsigned int>> parseStroke(std::string_view stroke)
+    {
+        unsigned int modifiers = 0;
+        for (auto plus = stroke.find('+'); plus != std::string_view::npos && plus + 1 < stroke.size();
+             plus = stroke.find('+'))
+        {
+            auto const modifier = stroke.substr(0, plus);
+            if (modifier == "Alt")
+                modifiers |= Alt;
+            else if (modifier == "Control")
+                modifiers |= Control;
+            else if (modifier == "Shift")
+                modifiers |= Shift;
+            else if (modifier == "System")
+                modifiers |= System;
+            else
+                return std::nullopt;
+            stroke.remove_prefix(plus + 1);
+        }
+
+        auto const key = string2key(stroke);
+        if (!key || *key == sf::Keyboard::Unknown)
+            return std::nullopt;
+        return std::make_pair(*key, modifiers);
+    }
+
+private:
+    std::vector<Binding> bindings = std::vector<Binding>(tableSize);
+    std::size_t table = 0; // where the next key is looked up, past the start of a chord
+    std::string path;
+    std::unique_ptr<FileWatcher> watcher;
+};
+
+namespace
+{
+    KeyBindings keyBindings;
+}
+
+
+
+// Every system cursor and the icon cursor, each created once so that
+// switching cursor is only a setMouseCursor() call. Creating an sf::Cursor
+// allocates OS resources (an X11 cursor) and, for the icon, uploads its
+// pixels.
+class CursorCache
+{
+public:
+    // Index of the icon cursor, after those of sf::Cursor::Type
+    static constexpr std::size_t Icon = sf::Cursor::NotAllowed + 1;
+    static constexpr std::size_t Count = Icon + 1;
+
+    explicit CursorCache(sf::Image const& icon) : icon(icon) {}
+
+    // Cursor of type `index`, or Icon. Cursors the system lacks fall back to
+    // the arrow.
+    sf::Cursor const& get(std::size_t index)
+    {
+        auto& entry = entries[index];
+        if (entry.state == Unloaded)
+        {
+            bool const loaded = index == Icon
+                                    ? entry.cursor.loadFromPixels(icon.getPixelsPtr(), icon.getSize(),
+                                                                  icon.getSize() / 2u)
+                                    : entry.cursor.loadFromSystem(static_cast<sf::Cursor::Type>(index));
+            entry.state = loaded ? Loaded : Missing;
+        }
+
+        if (entry.state == Missing && index != sf::Cursor::Arrow)
+            return get(sf::Cursor::Arrow);
+        return entry.cursor;
+    }
+
+    // Create every cursor now rather than on first use
+    void preload()
+    {
+        for (std::size_t index = 0; index < Count; ++index)
+            get(index);
+    }
+
+private:
+    enum State
+    {
+        Unloaded,
+        Loaded,
+        Missing,
+    };
+
+    struct Entry
+    {
+        State state = Unloaded;
+        sf::Cursor cursor;
+    };
+
+    sf::Image const& icon;
+    std::array<Entry, Count> entries;
+};
+
+
+
+// Actions that only change what is displayed
+void applyDisplayAction(Action action)
+{
+    switch (action)
+    {
+    default:
+        break;
+
+    case Action::ToggleJoystickTable:
+        displayJoystickTable = !displayJoystickTable;
+        break;
+
+    case Action::ToggleStats:
+        displayStats = !displayStats;
+        break;
+
+    case Action::ToggleTextInput:
+        textInput = !textInput;
+        break;
+
+    case Action::NextPacing:
+        pacing = static_cast<Pacing>((static_cast<int>(pacing) + 1) % static_cast<int>(Pacing::Count));
+        break;
+
+    case Action::EnlargeGrid:
+        gridSize = std::min<std::size_t>(gridSize * 2, 800);
+        break;
+
+    case Action::ShrinkGrid:
+        gridSize = std::max<std::size_t>(gridSize / 2, 5);
+        break;
+    }
+}
+
+// Actions on the window or the OS. They must run on the thread owning the
+// window; `logger` is anything with log(LogRecord) and log(sf::String).
+template <class Logger>
+void applyWindowAction(Logger& logger, sf::RenderWindow& window, CursorCache& cursors, Action action)
+{
+    switch (action)
+    {
+    default:
+        break;
+
+    case Action::ToggleGrab:
+        grabbed = !grabbed;
+        logger.log(LogRecord::text(grabbed ? "Grabbed" : "Released"));
+        window.setMouseCursorGrabbed(grabbed);
+        break;
+
+    case Action::ArrowCursor:
+        window.setMouseCursor(cursors.get(sf::Cursor::Arrow));
+        break;
+
+    case Action::CrossCursor:
+        window.setMouseCursor(cursors.get(sf::Cursor::Cross));
+        break;
+
+    case Action::HandCursor:
+        window.setMouseCursor(cursors.get(sf::Cursor::Hand));
+        break;
+
+    case Action::IconCursor:
+        window.setMouseCursor(cursors.get(CursorCache::Icon));
+        break;
+
+    case Action::Close:
+        window.close();
+        break;
+
+    case Action::Fullscreen:
+        goFullscreen(window);
+        break;
+
+    case Action::Windowed:
+        goWindowed(window);
+        break;
+
+    case Action::WarpMouse:
+        sf::Mouse::setPosition({ 100, 100 }, window);
+        break;
+
+    case Action::WarpMouseDesktop:
+        sf::Mouse::setPosition({ 100, 100 });
+        break;
+
+    case Action::LogPosition:
+        LOGXY(window.getPosition());
+        break;
+
+    case Action::MoveWindow:
+        window.setPosition({100, 100});
+        break;
+
+    case Action::LogDesktopMode:
+        LOGWidthHeight(sf::VideoMode::getDesktopMode());
+        break;
+
+    case Action::LogSize:
+        LOGXY(window.getSize());
+        break;
+
+    case Action::ResizeWindow: {
+        window.setSize({400, 600});
+        sf::FloatRect visibleArea(0, 0, 400, 600);
+        window.setView(sf::View(visibleArea));
+        break;
+    }
+
+    case Action::PasteClipboard:
+        logger.log(sf::Clipboard::getString());
+        break;
+
+    case Action::CopyClipboard:
+        sf::Clipboard::setString(L"∆ß∂ƒ¬qø");
+        break;
+    }
+}
+
+// Actions on the history view, if any, and on the text input
+void applyViewAction(HistoryView* history, InputPanel& input, Action action)
+{
+    switch (action)
+    {
+    default:
+        break;
+
+    case Action::HistoryOlder:
+        if (history)
+            history->pageUp();
+        break;
+
+    case Action::HistoryNewer:
+        if (history)
+            history->pageDown();
+        break;
+
+    case Action::HistoryLatest:
+        if (history)
+            history->showLatest();
+        break;
+
+    case Action::HistoryTypeFilter:
+        if (history)
+            history->nextTypeFilter();
+        break;
+
+    case Action::HistoryKeyFilter:
+        if (history)
+            history->toggleKeyFilter();
+        break;
+
+    case Action::CursorLeft:
+        if (input.cursor() > 0)
+            input.moveCursor(input.cursor() - 1);
+        break;
+
+    case Action::CursorRight:
+        input.moveCursor(input.cursor() + 1);
+        break;
+
+    case Action::PasteText:
+    {
+        auto const text = sf::Clipboard::getString();
+        input.paste(text.begin(), text.end());
+        break;
+    }
+    }
+}
+
+// `windowPtr` is null when events are replayed without a window, in which
+// case the actions on the window and the OS are skipped. Returns the action
+// triggered by the event, for applyViewAction().
+Action handleEvent(GraphicLogger& logger, JoystickTable& joyInfo, sf::RenderWindow* windowPtr, CursorCache& cursors,
+                   EventCoalescer::Entry const& entry)
+{
+    auto const& event = entry.event;
+
+    // Close window : exit
+    if (event.type == sf::Event::Closed)
+    {
+        // window.close();
+    }
+
+    logEvent(logger, joyInfo, entry);
+
+    // While text is typed, keys only type and edit it; paste-clipboard
+    // (System+V) pastes into it like paste-text
+    auto action = keyBindings.dispatch(event);
+    if (textInput && action == Action::PasteClipboard)
+        action = Action::PasteText;
+    else if (textInput && action != Action::ToggleTextInput && !isTextAction(action))
+        action = Action::None;
+    else if (!textInput && isTextAction(action))
+        action = Action::None;
+    applyDisplayAction(action);
+    if (windowPtr)
+        applyWindowAction(logger, *windowPtr, cursors, action);
+    return action;
+}
+
+Action handleEvent(GraphicLogger& logger, JoystickTable& joyInfo, sf::RenderWindow* windowPtr, CursorCache& cursors,
+                   sf::Event const& event)
+{
+    return handleEvent(logger, joyInfo, windowPtr, cursors, EventCoalescer::Entry{ event, {}, 1 });
+}
+
+bool hasOption(int argc, char const** argv, std::string const& option)
+{
+    return std::find(argv + 1, argv + argc, option) != argv + argc;
+}
+
+// Value of `--option=value`, or `fallback` if the option is not given
+std::string optionValue(int argc, char const** argv, std::string const& option, std::string const& fallback)
+{
+    auto const prefix = option + "=";
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string const arg = argv[i];
+        if (arg.compare(0, prefix.size(), prefix) == 0)
+            return arg.substr(prefix.size());
+    }
+    return fallback;
+}
+
+// --coalesce=<types> lists the event types to merge, e.g.
+// --coalesce=MouseMoved,JoystickMoved, or none; all motion events by default
+EventCoalescer makeCoalescer(int argc, char const** argv)
+{
+    EventCoalescer coalescer;
+
+    auto const types = optionValue(argc, argv, "--coalesce", "");
+    if (types.empty())
+        return coalescer;
+
+    char const* const names[] = { "MouseMoved", "MouseWheelMoved", "MouseWheelScrolled", "JoystickMoved",
+                                  "TouchMoved" };
+    sf::Event::EventType const values[] = { sf::Event::MouseMoved, sf::Event::MouseWheelMoved,
+                                            sf::Event::MouseWheelScrolled, sf::Event::JoystickMoved,
+                                            sf::Event::TouchMoved };
+    for (std::size_t i = 0; i < 5; ++i)
+        coalescer.setEnabled(values[i], ("," + types + ",").find("," + std::string(names[i]) + ",") != std::string::npos);
+
+    return coalescer;
+}
+
+// char const interfaceFontFile[] = "sansation.ttf";
+char const interfaceFontFile[] = "FiraCode-Light.ttf";
+// char const interfaceFontFile[] = "HelveticaNeue.ttf";
+
+// Get the font of the user interface and prewarm it for the logger and
+// joystick table (20), the window count (30) and the timing overlay (14), with
+// printable ASCII, the clipboard sample and `--glyphs=<characters>`. Null if
+// the font cannot be loaded.
+sf::Font const* loadInterfaceFont(FontCache& fonts, ResourceManager& resources, int argc, char const** argv)
+{
+    auto const* font = resources.font(interfaceFontFile);
+    if (!font)
+        return nullptr;
+
+    sf::String characters;
+    for (sf::Uint32 c = 0x20; c < 0x7F; ++c)
+        characters += c;
+    characters += L"∆ß∂ƒ¬qø";
+    auto const extra = optionValue(argc, argv, "--glyphs", "");
+    characters += sf::String::fromUtf8(extra.begin(), extra.end());
+
+    for (auto size : { 14u, 20u, 30u })
+        fonts.prewarm(*font, size, characters);
+
+    return font;
+}
+
+// The interface font and icon, and the logger, joystick table and cursors of
+// the window over them, for the benchmarks and --replay. `loaded` is false if
+// the font or the icon could not be loaded.
+struct BenchmarkScene
+{
+    BenchmarkScene()
+    {
+        logger.setPosition(50, 50);
+        joyInfo.setPosition(50, 50);
+    }
+
+    sf::Font font;
+    sf::Image icon;
+    bool loaded = font.loadFromFile(resourcePath() + interfaceFontFile) &&
+                  icon.loadFromFile(resourcePath() + "icon.png");
+    GraphicLogger logger{ font, 20, 20 };
+    JoystickTable joyInfo{ font, 20 };
+    CursorCache cursors{ icon };
+};
+
+// Measure the cost of GraphicLogger::log() when events flood in, with one
+// offscreen draw per simulated frame.
+int benchmarkLogger()
+{
+    BenchmarkScene scene;
+    if (!scene.loaded)
+        return EXIT_FAILURE;
+
+    sf::RenderTexture target;
+    if (!target.create(800, 600))
+        return EXIT_FAILURE;
+
+    auto& logger = scene.logger;
+
+    unsigned int const events = 100000;
+    unsigned int const eventsPerFrame = 50;
+
+    auto const allocations = allocationCount.load();
+    sf::Clock clock;
+    for (unsigned int i = 0; i < events; ++i)
+    {
+        logger.log(LogRecord::text("MouseMoved"));
+        logger.log(LogRecord::pair("event.mouseMove", i % 800, i % 600));
+
+        if (i % eventsPerFrame == 0)
+        {
+            target.clear();
+            target.draw(logger);
+            target.display();
+        }
+    }
+    auto const elapsed = clock.getElapsedTime();
+
+    auto const allocated = allocationCount.load() - allocations;
+
+    std::cout << "GraphicLogger: " << events << " events, "
+              << elapsed.asMicroseconds() * 1000.0 / events << " ns/event, "
+              << allocationRate(allocated, events, "event") << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+// Synthetic event streams for --bench-events, generated up front so that only
+// the dispatch is measured. The generator is seeded for reproducible runs.
+std::vector<sf::Event> generateEvents(std::string const& stream, std::size_t count)
+{
+    std::minstd_rand random(42);
+    auto uniform = [&](int min, int max) { return std::uniform_int_distribution<int>(min, max)(random); };
+
+    std::vector<sf::Event> events;
+    events.reserve(count);
+
+    sf::Event event;
+    if (stream == "mouse")
+    {
+        // Random walk of the pointer
+        event.type = sf::Event::MouseMoved;
+        event.mouseMove = { 400, 300 };
+        while (events.size() < count)
+        {
+            event.mouseMove.x = std::clamp(event.mouseMove.x + uniform(-3, 3), 0, 799);
+            event.mouseMove.y = std::clamp(event.mouseMove.y + uniform(-3, 3), 0, 599);
+            events.push_back(event);
+        }
+    }
+    else if (stream == "keys")
+    {
+        // Auto-repeated KeyPressed bursts ended by a KeyReleased. The members
+        // are set by name: SFML 2.6 inserts a scancode after the key code.
+        event.key.alt = false;
+        event.key.control = false;
+        event.key.shift = false;
+        event.key.system = false;
+        while (events.size() < count)
+        {
+            event.key.code = static_cast<sf::Keyboard::Key>(uniform(0, sf::Keyboard::KeyCount - 1));
+            event.type = sf::Event::KeyPressed;
+            for (int repeat = uniform(1, 30); repeat > 0 && events.size() + 1 < count; --repeat)
+                events.push_back(event);
+            event.type = sf::Event::KeyReleased;
+            events.push_back(event);
+        }
+    }
+    else if (stream == "joystick")
+    {
+        // Every axis of 8 joysticks jittering around its rest position
+        event.type = sf::Event::JoystickMoved;
+        while (events.size() < count)
+        {
+            event.joystickMove.joystickId = uniform(0, sf::Joystick::Count - 1);
+            event.joystickMove.axis = static_cast<sf::Joystick::Axis>(uniform(0, sf::Joystick::AxisCount - 1));
+            event.joystickMove.position = uniform(-500, 500) / 100.f;
+            events.push_back(event);
+        }
+    }
+    else if (stream == "resize")
+    {
+        event.type = sf::Event::Resized;
+        while (events.size() < count)
+        {
+            event.size = { static_cast<unsigned int>(uniform(200, 3840)), static_cast<unsigned int>(uniform(200, 2160)) };
+            events.push_back(event);
+        }
+    }
+    else if (stream == "text")
+    {
+        // ASCII, Latin-1, Greek, CJK and emoji code points
+        sf::Uint32 const ranges[][2] = {
+            { 0x20, 0x7E }, { 0xA0, 0xFF }, { 0x391, 0x3C9 }, { 0x4E00, 0x9FFF }, { 0x1F600, 0x1F64F },
+        };
+        event.type = sf::Event::TextEntered;
+        while (events.size() < count)
+        {
+            auto const& range = ranges[uniform(0, 4)];
+            event.text.unicode = range[0] + uniform(0, range[1] - range[0]);
+            events.push_back(event);
+        }
+    }
+
+    return events;
+}
+
+// Draw the logger and the window count offscreen, the way they used to be
+// drawn (one sf::Text per row and a temporary one for the count) and through
+// a text batch, and compare the draw calls, time and allocations per frame.
+// Timings include a final read back, so that the GPU work is accounted for.
+int benchmarkText(int argc, char const** argv)
+{
+    auto const frames = std::stoul(optionValue(argc, argv, "--frames", "2000"));
+
+    BenchmarkScene scene;
+    if (!scene.loaded)
+        return EXIT_FAILURE;
+
+    sf::RenderTexture target;
+    if (!target.create(800, 600))
+        return EXIT_FAILURE;
+
+    auto const& font = scene.font;
+    auto& logger = scene.logger;
+    auto& joyInfo = scene.joyInfo;
+    std::vector<sf::Text> rows;
+    for (auto const& event : generateEvents("keys", 20))
+    {
+        auto const record = LogRecord::key(event.key.code, event.type == sf::Event::KeyPressed);
+        logger.log(record);
+
+        char text[64];
+        auto const end = formatRecord(record, text, text + sizeof(text));
+        rows.emplace_back(std::to_string(rows.size()) + ": " + std::string(text, end), font, 20);
+    }
+    // Most recent row first, as GraphicLogger does
+    std::reverse(rows.begin(), rows.end());
+    for (std::size_t i = 0; i < rows.size(); ++i)
+        rows[i].setPosition(50, 50 + i * (20 * 1.1f));
+
+    TextBatch sceneText;
+    auto run = [&](char const* name, auto drawFrame) {
+        std::size_t calls = 0;
+        auto const allocations = allocationCount.load();
+        sf::Clock clock;
+        for (unsigned long i = 0; i < frames; ++i)
+        {
+            target.clear();
+            calls = drawFrame();
+            target.display();
+        }
+        target.getTexture().copyToImage();
+        auto const elapsed = clock.getElapsedTime();
+        auto const allocated = allocationCount.load() - allocations;
+
+        std::cout << name << ": " << calls << " draw calls/frame, " << elapsed.asMicroseconds() / frames
+                  << " us/frame, " << allocationRate(allocated, frames, "frame") << std::endl;
+    };
+
+    run("sf::Text per row", [&] {
+        for (auto const& row : rows)
+            target.draw(row);
+
+        sf::Text count(std::to_string(windowCount), font, 30);
+        count.setFillColor(sf::Color::Yellow);
+        count.setPosition(static_cast<sf::Vector2f>(target.getSize() / 2u));
+        target.draw(count);
+
+        drawBorder(target);
+        return rows.size() + 2;
+    });
+
+    run("Text batch", [&] {
+        drawScene(target, font, sceneText, logger, joyInfo);
+        return sceneText.drawCalls() + 1;
+    });
+
+    return EXIT_SUCCESS;
+}
+
+// Peak resident set size, in KiB
+long peakResidentSize()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef SFML_SYSTEM_MACOS
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+// Paste `--paste-size=<n>` code points (4 Mi) of multilingual text into the
+// text input several times, and after each paste type and erase characters
+// at the end and in the middle of the text, laying out the visible rows after
+// every edit as the window would. Prints the time per paste, per character
+// typed and per cursor jump, which should not grow with the text.
+int benchmarkInput(int argc, char const** argv)
+{
+    auto const pasteSize = std::stoul(optionValue(argc, argv, "--paste-size", "4194304"));
+
+    BenchmarkScene scene;
+    if (!scene.loaded)
+        return EXIT_FAILURE;
+    InputPanel input{ scene.font, 20, 19, 56 };
+
+    std::u32string_view const lines[] = {
+        U"The quick brown fox jumps over the lazy dog.\n",
+        U"Zwölf Boxkämpfer jagen Viktor quer über den großen Sylter Deich, ",
+        U"Съешь же ещё этих мягких французских булок, да выпей чаю.\r\n",
+        U"\t∆ß∂ƒ¬qø — ",
+        U"いろはにほへと ちりぬるを\n",
+    };
+    std::u32string text;
+    for (std::size_t i = 0; text.size() < pasteSize; ++i)
+        text += lines[i % std::size(lines)];
+    text.resize(pasteSize);
+
+    std::size_t const typed = 2000;
+    auto const typeAndErase = [&] {
+        sf::Clock clock;
+        for (std::size_t i = 0; i < typed; ++i)
+        {
+            input.type(i % 3 == 2 ? U'\b' : U'a' + i % 26);
+            input.update();
+        }
+        return clock.getElapsedTime().asMicroseconds() * 1000.0 / typed;
+    };
+
+    for (int round = 1; round <= 4; ++round)
+    {
+        sf::Clock clock;
+        input.paste(text.begin(), text.end());
+        input.update();
+        auto const pasted = clock.restart();
+
+        auto const atEnd = typeAndErase();
+
+        clock.restart();
+        input.moveCursor(input.size() / 2);
+        input.update();
+        auto const jump = clock.getElapsedTime();
+
+        auto const inMiddle = typeAndErase();
+        input.moveCursor(input.size());
+
+        std::cout << "Text input with " << input.size() << " characters: paste " << pasted.asMilliseconds()
+                  << " ms, typing " << atEnd << " ns/char at the end and " << inMiddle
+                  << " ns/char in the middle, cursor jump " << jump.asMicroseconds() << " us" << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// Current resident set size, in KiB, or the peak one where it is unknown
+long residentSize()
+{
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0;
+    if (statm >> pages >> pages)
+        return pages * (::sysconf(_SC_PAGESIZE) / 1024);
+    return peakResidentSize();
+}
+
+// Number of open file descriptors, or -1 where it is unknown
+int openFileCount()
+{
+    DIR* directory = ::opendir("/proc/self/fd");
+    if (!directory)
+        return -1;
+
+    int count = 0;
+    while (dirent const* entry = ::readdir(directory))
+        count += entry->d_name[0] != '.';
+    ::closedir(directory);
+    return count - 1; // the directory itself
+}
+
+// Toggle the window between fullscreen and windowed mode by feeding F and N
+// key releases through handleEvent(), drawing a frame after each switch.
+// Prints the switch times, then what the process gained after the first
+// switches: resident memory, file descriptors and heap allocations, which
+// should not grow with the number of switches, and whether the glyph atlas
+// texture survived.
+int benchmarkModes(int argc, char const** argv)
+{
+    auto const toggles = std::stoul(optionValue(argc, argv, "--toggles", "200"));
+    std::size_t const warmup = std::min<std::size_t>(10, toggles);
+
+    BenchmarkScene scene;
+    if (!scene.loaded)
+        return EXIT_FAILURE;
+
+    auto const& font = scene.font;
+    auto& logger = scene.logger;
+    auto& joyInfo = scene.joyInfo;
+    auto& cursors = scene.cursors;
+    TextBatch sceneText;
+
+    sf::RenderWindow window;
+    goWindowed(window);
+
+    long resident = 0;
+    int files = 0;
+    std::uint64_t allocations = 0;
+    unsigned int glyphTexture = 0;
+
+    sf::Event toggle;
+    toggle.type = sf::Event::KeyReleased;
+    toggle.key.code = sf::Keyboard::Unknown;
+    toggle.key.alt = false;
+    toggle.key.control = false;
+    toggle.key.shift = false;
+    toggle.key.system = false;
+    for (std::size_t i = 0; i < toggles && window.isOpen(); ++i)
+    {
+        if (i == warmup)
+        {
+            resident = residentSize();
+            files = openFileCount();
+            allocations = allocationCount.load();
+            glyphTexture = font.getTexture(20).getNativeHandle();
+        }
+
+        toggle.key.code = i % 2 == 0 ? sf::Keyboard::F : sf::Keyboard::N;
+        handleEvent(logger, joyInfo, &window, cursors, toggle);
+
+        sf::Event event;
+        while (window.pollEvent(event))
+            handleEvent(logger, joyInfo, &window, cursors, event);
+
+        window.clear();
+        drawScene(window, font, sceneText, logger, joyInfo);
+        window.display();
+        modeSwitches.presented();
+    }
+
+    modeSwitches.report(std::cout);
+    if (toggles > warmup)
+    {
+        auto const measured = toggles - warmup;
+        std::cout << "After " << warmup << " switches: resident memory " << std::showpos << residentSize() - resident
+                  << " KiB, open files " << openFileCount() - files << std::noshowpos << ", "
+                  << allocationRate(allocationCount.load() - allocations, measured, "switch") << std::endl;
+        std::cout << "Glyph atlas texture "
+                  << (font.getTexture(20).getNativeHandle() == glyphTexture ? "kept" : "created again") << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// Switch cursors in a window, in turn through every system cursor and the
+// icon one, first reloading a single sf::Cursor each time as the shortcuts
+// used to, then from the cursor cache. Prints the time per switch, the heap
+// allocations and the growth of the resident memory of each way.
+int benchmarkCursors(int argc, char const** argv)
+{
+    auto const switches = std::stoul(optionValue(argc, argv, "--switches", "10000"));
+
+    BenchmarkScene scene;
+    if (!scene.loaded)
+        return EXIT_FAILURE;
+    sf::RenderWindow window(sf::VideoMode(400, 300), "Cursor benchmark");
+
+    auto const& icon = scene.icon;
+    auto& cursors = scene.cursors;
+    sf::Clock clock;
+    cursors.preload();
+    std::cout << "Cursor cache: " << CursorCache::Count << " cursors created in "
+              << clock.getElapsedTime().asMicroseconds() << " us" << std::endl;
+
+    auto const run = [&](char const* name, auto const& switchTo) {
+        Histogram latency; // ns
+        auto const allocations = allocationCount.load();
+        auto const resident = residentSize();
+
+        for (std::size_t i = 0; i < switches && window.isOpen(); ++i)
+        {
+            auto const start = std::chrono::steady_clock::now();
+            switchTo(i % CursorCache::Count);
+            auto const elapsed = std::chrono::steady_clock::now() - start;
+            latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+
+            // Let the window answer the window manager
+            sf::Event event;
+            while (i % 64 == 0 && window.pollEvent(event))
+                if (event.type == sf::Event::Closed)
+                    window.close();
+        }
+
+        auto const allocated = allocationCount.load() - allocations;
+        std::cout << name << ": " << latency.count() << " switches, p50 " << latency.percentile(50) << " ns, p99 "
+                  << latency.percentile(99) << " ns, max " << latency.max() << " ns, "
+                  << allocationRate(allocated, latency.count(), "switch") << ", resident memory " << std::showpos
+                  << residentSize() - resident << std::noshowpos << " KiB" << std::endl;
+    };
+
+    sf::Cursor cursor;
+    run("reload", [&](std::size_t index) {
+        if (index == CursorCache::Icon)
+            cursor.loadFromPixels(icon.getPixelsPtr(), icon.getSize(), icon.getSize() / 2u);
+        else
+            cursor.loadFromSystem(static_cast<sf::Cursor::Type>(index));
+        window.setMouseCursor(cursor);
+    });
+    run("cached", [&](std::size_t index) { window.setMouseCursor(cursors.get(index)); });
+
+    return EXIT_SUCCESS;
+}
+
+// Drive synthetic event streams through the same coalescing and handleEvent()
+// as the main loop, without a window, 64 events per simulated frame.
+int benchmarkEvents(int argc, char const** argv)
+{
+    auto const count = std::stoul(optionValue(argc, argv, "--bench-count", "200000"));
+    auto const streams = optionValue(argc, argv, "--bench-streams", "mouse,keys,joystick,resize,text");
+
+    BenchmarkScene scene;
+    if (!scene.loaded)
+        return EXIT_FAILURE;
+    auto coalescer = makeCoalescer(argc, argv);
+
+    std::size_t const eventsPerFrame = 64;
+
+    std::stringstream list(streams);
+    std::string stream;
+    while (std::getline(list, stream, ','))
+    {
+        auto const events = generateEvents(stream, count);
+        if (events.empty())
+        {
+            std::cerr << "Unknown stream " << stream << ", expected mouse, keys, joystick, resize or text"
+                      << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        auto const allocations = allocationCount.load();
+        std::uint64_t dispatched = 0;
+
+        sf::Clock clock;
+        for (std::size_t first = 0; first < events.size(); first += eventsPerFrame)
+        {
+            auto const last = std::min(first + eventsPerFrame, events.size());
+            for (auto i = first; i < last; ++i)
+                coalescer.push(events[i]);
+
+            for (auto const& entry : coalescer.events())
+                handleEvent(scene.logger, scene.joyInfo, nullptr, scene.cursors, entry);
+            dispatched += coalescer.events().size();
+            coalescer.clear();
+        }
+        auto const elapsed = clock.getElapsedTime();
+        auto const allocated = allocationCount.load() - allocations;
+
+        auto const seconds = std::max(elapsed.asSeconds(), 1e-6f);
+        std::cout << stream << ": " << events.size() << " events (" << dispatched << " dispatched), "
+                  << static_cast<std::uint64_t>(events.size() / seconds) << " events/s, "
+                  << elapsed.asMicroseconds() * 1000.0 / events.size() << " ns/event, "
+                  << allocationRate(allocated, events.size(), "event") << ", peak RSS "
+                  << peakResidentSize() << " KiB" << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// Feed a recorded trace through the same coalescing and event handling code
+// as the window, without one, either at its original pace or as fast as
+// possible. Like --headless, events are grouped into frames of 1/30 s of
+// recorded time since the trace does not record frame boundaries.
+int replayTrace(std::string const& path, bool realTime, EventCoalescer coalescer)
+{
+    TraceReader trace;
+    if (!trace.open(path))
+        return EXIT_FAILURE;
+
+    BenchmarkScene scene;
+    if (!scene.loaded)
+        return EXIT_FAILURE;
+
+    std::size_t nextRecord = 0;
+    std::uint64_t dispatched = 0;
+    sf::Clock clock;
+    for (sf::Int64 frame = 0; nextRecord < trace.size(); ++frame)
+    {
+        // Frames without events are skipped, or slept through in real time
+        if (!realTime)
+            frame = std::max(frame, trace[nextRecord].timestamp * 30 / 1000000);
+
+        auto const frameEnd = sf::microseconds((frame + 1) * 1000000 / 30);
+        for (; nextRecord < trace.size() && sf::microseconds(trace[nextRecord].timestamp) < frameEnd; ++nextRecord)
+            coalescer.push(trace[nextRecord].event);
+
+        if (realTime)
+        {
+            auto const now = clock.getElapsedTime();
+            if (frameEnd > now)
+                sf::sleep(frameEnd - now);
+        }
+
+        for (auto const& entry : coalescer.events())
+            handleEvent(scene.logger, scene.joyInfo, nullptr, scene.cursors, entry);
+        dispatched += coalescer.events().size();
+        coalescer.clear();
+    }
+    auto const elapsed = clock.getElapsedTime();
+
+    std::cout << "Replayed " << trace.size() << " events (" << dispatched << " dispatched) in "
+              << elapsed.asMilliseconds() << " ms";
+    if (trace.size() > 0)
+        std::cout << ", " << elapsed.asMicroseconds() * 1000.0 / trace.size() << " ns/event";
+    std::cout << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+// Render the whole scene into an offscreen texture as fast as possible,
+// optionally replaying a trace (one frame per 1/30 s of recorded time) and
+// dumping every frame. The grid and cursor are always drawn.
+int runHeadless(int argc, char const** argv)
+{
+    auto const frames = std::stoul(optionValue(argc, argv, "--frames", "600"));
+    auto const tracePath = optionValue(argc, argv, "--replay", "");
+    auto const dumpFormat = optionValue(argc, argv, "--dump", "");
+    auto const dumpDirectory = optionValue(argc, argv, "--dump-dir", ".");
+
+    TraceReader trace;
+    if (!tracePath.empty() && !trace.open(tracePath))
+        return EXIT_FAILURE;
+
+    std::unique_ptr<FrameEncoder> encoder;
+    if (dumpFormat == "png")
+        encoder = std::make_unique<FrameEncoder>(dumpDirectory, FrameEncoder::Format::Png);
+    else if (dumpFormat == "raw")
+        encoder = std::make_unique<FrameEncoder>(dumpDirectory, FrameEncoder::Format::Raw);
+    else if (!dumpFormat.empty())
+    {
+        std::cerr << "Unknown dump format " << dumpFormat << ", expected png or raw" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    sf::RenderTexture target;
+    if (!target.create(800, 600))
+        return EXIT_FAILURE;
+    ++windowCount;
+
+    ResourceManager resources;
+    FontCache fonts;
+    auto const* interfaceFont = loadInterfaceFont(fonts, resources, argc, argv);
+    if (!interfaceFont)
+        return EXIT_FAILURE;
+    auto const& font = *interfaceFont;
+
+    auto cursorShape = makeCursorShape();
+    cursorShape.setPosition(400, 300);
+    GridCache grid;
+    TextBatch sceneText;
+
+    GraphicLogger logger{ font, 20, 20 };
+    logger.setPosition(50, 50);
+    JoystickTable joyInfo{ font, 20 };
+    joyInfo.setPosition(50, 50);
+
+    sf::Image icon;
+    CursorCache cursors{ icon };
+
+    auto coalescer = makeCoalescer(argc, argv);
+    std::size_t nextRecord = 0;
+
+    sf::Clock clock;
+    for (unsigned long frame = 0; frame < frames; ++frame)
+    {
+        auto const frameEnd = sf::microseconds(static_cast<sf::Int64>(frame + 1) * 1000000 / 30);
+        for (; nextRecord < trace.size() && sf::microseconds(trace[nextRecord].timestamp) < frameEnd; ++nextRecord)
+            coalescer.push(trace[nextRecord].event);
+
+        for (auto const& entry : coalescer.events())
+        {
+            handleEvent(logger, joyInfo, nullptr, cursors, entry);
+            if (entry.event.type == sf::Event::MouseMoved)
+                cursorShape.setPosition(entry.event.mouseMove.x, entry.event.mouseMove.y);
+        }
+        coalescer.clear();
+
+        joyInfo.update();
+
+        target.clear();
+        drawScene(target, font, sceneText, logger, joyInfo);
+        grid.draw(target, gridSize);
+        target.draw(cursorShape);
+        target.display();
+
+        if (encoder)
+            encoder->push(target.getTexture().copyToImage());
+    }
+    auto const elapsed = clock.getElapsedTime();
+    encoder.reset();
+
+    std::cout << "Headless: " << frames << " frames in " << elapsed.asMilliseconds() << " ms, "
+              << elapsed.asMicroseconds() / 1000.0 / frames << " ms/frame" << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+// A scripted scene of the pixel regression suite, drawn from scratch into
+// `target` so that it looks the same on every run
+struct RegressionScene
+{
+    char const* name;
+    void (*draw)(sf::RenderTarget& target, sf::Font const& font);
+};
+
+void drawLoggerScene(sf::RenderTarget& target, sf::Font const& font, int lines)
+{
+    GraphicLogger logger{ font, 20, 20 };
+    logger.setPosition(50, 50);
+    for (int i = 0; i < lines; ++i)
+    {
+        switch (i % 5)
+        {
+        case 0:
+            logger.log(LogRecord::key(static_cast<sf::Keyboard::Key>(i % sf::Keyboard::KeyCount), i % 2));
+            break;
+
+        case 1:
+            logger.log(LogRecord::pair("mouseMove", i * 7, i * 3));
+            break;
+
+        case 2:
+            logger.log(LogRecord::real("\tposition:", i * 0.25f));
+            break;
+
+        case 3:
+            logger.log(LogRecord::codePoint("\tunicode: ", 0x2206 + i));
+            break;
+
+        default:
+            logger.log(sf::String(L"∆ß∂ƒ¬qø"));
+            break;
+        }
+    }
+
+    TextBatch text;
+    logger.appendTo(text);
+    target.draw(text);
+}
+
+void drawJoystickScene(sf::RenderTarget& target, sf::Font const& font)
+{
+    JoystickSnapshot snapshot;
+    for (unsigned int id = 0; id < sf::Joystick::Count; ++id)
+    {
+        auto& sample = snapshot.latest[id];
+        sample.connected = id < 2;
+        sample.buttonCount = sample.connected ? 12 : 0;
+        sample.buttons = sample.connected ? 0x5A5u >> id : 0;
+        for (int i = 0; i < sf::Joystick::AxisCount; ++i)
+        {
+            sample.axes[i] = sample.connected ? -100 + 25.f * i + id : std::numeric_limits<float>::quiet_NaN();
+            snapshot.statistics[id][i] = { -10.f * i, 10.f * i, 0.125f * i, 250u - i };
+        }
+    }
+    snapshot.sampleRate = 1000;
+
+    JoystickTable joyInfo{ font, 20 };
+    joyInfo.setPosition(50, 50);
+    joyInfo.setJoystick(1);
+    joyInfo.update(snapshot);
+
+    TextBatch text;
+    joyInfo.appendTo(text);
+    target.draw(text);
+}
+
+void drawGridScene(sf::RenderTarget& target, std::size_t size)
+{
+    GridCache grid;
+    grid.draw(target, size);
+}
+
+void drawCursorScene(sf::RenderTarget& target)
+{
+    auto cursorShape = makeCursorShape();
+    cursorShape.setPosition(400, 300);
+    target.draw(cursorShape);
+    cursorShape.setPosition(0, 0);
+    target.draw(cursorShape);
+}
+
+constexpr RegressionScene regressionScenes[] = {
+    { "logger-1", [](sf::RenderTarget& target, sf::Font const& font) { drawLoggerScene(target, font, 1); } },
+    { "logger-20", [](sf::RenderTarget& target, sf::Font const& font) { drawLoggerScene(target, font, 20); } },
+    { "logger-1000", [](sf::RenderTarget& target, sf::Font const& font) { drawLoggerScene(target, font, 1000); } },
+    { "joystick-table", drawJoystickScene },
+    { "border", [](sf::RenderTarget& target, sf::Font const&) { drawBorder(target); } },
+    { "grid-5", [](sf::RenderTarget& target, sf::Font const&) { drawGridScene(target, 5); } },
+    { "grid-50", [](sf::RenderTarget& target, sf::Font const&) { drawGridScene(target, 50); } },
+    { "grid-800", [](sf::RenderTarget& target, sf::Font const&) { drawGridScene(target, 800); } },
+    { "cursor", [](sf::RenderTarget& target, sf::Font const&) { drawCursorScene(target); } },
+};
 
-                    LOGEvent(KeyReleased);
-                    LOGKey(event);
-                    break;
+// Compare two images of the same size: count the pixels with a channel
+// differing by more than `tolerance`, and find the largest difference. The
+// loops work on plain byte and word arrays so that compilers vectorize them.
+// If given, `diff` shows the differing pixels in red over a dimmed `image`.
+struct ImageDifference
+{
+    std::size_t pixels = 0;
+    int largest = 0;
+};
 
-                    LOGEvent(MouseButtonPressed);
-                    LOGButton(event);
-                    LOGXY(event.mouseButton);
-                    break;
+ImageDifference compareImages(sf::Image const& image, sf::Image const& golden, int tolerance, sf::Image* diff)
+{
+    auto const size = image.getSize();
+    std::size_t const count = std::size_t(size.x) * size.y;
+    auto const* a = image.getPixelsPtr();
+    auto const* b = golden.getPixelsPtr();
+
+    std::vector<std::uint8_t> distance(count * 4);
+    for (std::size_t i = 0; i < count * 4; ++i)
+        distance[i] = static_cast<std::uint8_t>(a[i] > b[i] ? a[i] - b[i] : b[i] - a[i]);
+
+    ImageDifference result;
+    std::uint8_t largest = 0;
+    for (std::size_t i = 0; i < count * 4; ++i)
+        largest = std::max(largest, distance[i]);
+    result.largest = largest;
+
+    // One word per pixel, non-zero if any of its channels is over tolerance
+    std::vector<std::uint32_t> over(count);
+    for (std::size_t i = 0; i < count * 4; ++i)
+        distance[i] = distance[i] > tolerance;
+    std::memcpy(over.data(), distance.data(), distance.size());
+    for (std::size_t i = 0; i < count; ++i)
+        result.pixels += over[i] != 0;
+
+    if (diff && result.pixels > 0)
+    {
+        diff->create(size.x, size.y);
+        for (unsigned int y = 0; y < size.y; ++y)
+        {
+            for (unsigned int x = 0; x < size.x; ++x)
+            {
+                auto const i = std::size_t(y) * size.x + x;
+                auto const gray = static_cast<sf::Uint8>((a[i * 4] + a[i * 4 + 1] + a[i * 4 + 2]) / 12);
+                diff->setPixel(x, y, over[i] ? sf::Color::Red : sf::Color(gray, gray, gray));
+            }
+        }
+    }
+    return result;
+}
 
-                    LOGEvent(MouseButtonReleased);
-                    LOGButton(event);
-                    LOGXY(event.mouseButton);
-                    break;
+// Render the regression scenes offscreen, or only the one named by
+// --regress-scene, and compare them with the golden images of
+// `goldenDirectory`, or replace those with --regress-update. Each scene is
+// drawn --regress-frames times to time it; comparing, which decodes and
+// encodes PNG files, runs on a worker pool while the next scenes render.
+// The frame and a diff image of the scenes that fail are saved into
+// --regress-out. Returns EXIT_FAILURE if any scene fails.
+int runRegression(std::string const& goldenDirectory, int argc, char const** argv)
+{
+    bool const update = hasOption(argc, argv, "--regress-update");
+    auto const tolerance = std::stoi(optionValue(argc, argv, "--regress-tolerance", "2"));
+    auto const allowedPixels = std::stoul(optionValue(argc, argv, "--regress-pixels", "0"));
+    auto const frames = std::max(1ul, std::stoul(optionValue(argc, argv, "--regress-frames", "20")));
+    auto const outDirectory = optionValue(argc, argv, "--regress-out", ".");
+    auto const only = optionValue(argc, argv, "--regress-scene", "");
+
+    std::vector<RegressionScene const*> scenes;
+    for (auto const& scene : regressionScenes)
+        if (only.empty() || only == scene.name)
+            scenes.push_back(&scene);
+    if (scenes.empty())
+    {
+        std::cerr << "Unknown regression scene " << only << std::endl;
+        return EXIT_FAILURE;
+    }
 
-                    LOGEvent(MouseMoved);
-                    LOGXY(event.mouseMove);
-                    break;
+    sf::Font font;
+    if (!font.loadFromFile(resourcePath() + interfaceFontFile))
+        return EXIT_FAILURE;
+    sf::RenderTexture target;
+    if (!target.create(800, 600))
+        return EXIT_FAILURE;
 
-                    LOGEvent(MouseWheelMoved);
-                    LOGWheel(event.mouseWheel);
-                    LOGXY(event.mouseWheel);
-                    break;
+    struct Result
+    {
+        Histogram renderTime; // us
+        bool passed = false;
+        std::string message;
+    };
+    std::vector<Result> results(scenes.size());
 
-                    LOGEvent(MouseWheelScrolled);
-                    LOGWheel(event.mouseWheelScroll);
-                    LOGXY(event.mouseWheelScroll);
-                    logger.log(event.mouseWheelScroll.wheel == sf::Mouse::VerticalWheel
-                                   ? "VerticalWheel"
-                                   : "HorizontalWheel");
-                    break;
+    {
+        WorkerPool pool{ std::max(std::thread::hardware_concurrency(), 1u) };
+        for (std::size_t s = 0; s < results.size(); ++s)
+        {
+            auto const& scene = *scenes[s];
+            for (unsigned long frame = 0; frame < frames; ++frame)
+            {
+                sf::Clock clock;
+                target.clear();
+                scene.draw(target, font);
+                target.display();
+                results[s].renderTime.record(clock.getElapsedTime().asMicroseconds());
+            }
 
-                    LOGEvent(MouseEntered);
-                    break;
+            pool.post([&, s, image = target.getTexture().copyToImage()] {
+                auto& result = results[s];
+                std::string const name = scenes[s]->name;
+                auto const goldenPath = goldenDirectory + "/" + name + ".png";
 
-                    LOGEvent(MouseLeft);
-                    break;
+                if (update)
+                {
+                    result.passed = image.saveToFile(goldenPath);
+                    result.message = result.passed ? "golden image written" : "cannot write " + goldenPath;
+                    return;
+                }
 
-                    LOGEvent(JoystickButtonPressed);
-                    break;
+                sf::Image golden;
+                if (!golden.loadFromFile(goldenPath))
+                {
+                    result.message = "no golden image " + goldenPath + ", create it with --regress-update";
+                    return;
+                }
+                if (golden.getSize() != image.getSize())
+                {
+                    result.message = "golden image size differs";
+                    return;
+                }
 
-                    LOGEvent(JoystickButtonReleased);
-                    break;
+                sf::Image diff;
+                auto const difference = compareImages(image, golden, tolerance, &diff);
+                result.passed = difference.pixels <= allowedPixels;
+                result.message = std::to_string(difference.pixels) + " pixels over tolerance, largest difference " +
+                                 std::to_string(difference.largest);
+                if (!result.passed)
+                {
+                    image.saveToFile(outDirectory + "/" + name + ".png");
+                    diff.saveToFile(outDirectory + "/" + name + ".diff.png");
+                    result.message += ", see " + outDirectory + "/" + name + ".diff.png";
+                }
+            });
+        }
+    }
 
-                    LOGEvent(JoystickMoved);
-                    if (axisClocks[event.joystickMove.axis].getElapsedTime() > sf::seconds(2)) {
-                        logger.log("\tid:" + std::to_string(event.joystickMove.joystickId));
-                        logger.log("\tposition:" + std::to_string(event.joystickMove.position));
-                        logger.log("\taxis:" + axis2string(event.joystickMove.axis));
-                        axisClocks[event.joystickMove.axis].restart();
-                    }
-                    break;
+    std::size_t failed = 0;
+    for (std::size_t s = 0; s < results.size(); ++s)
+    {
+        auto const& result = results[s];
+        failed += !result.passed;
+        std::cout << (result.passed ? "ok     " : "FAILED ") << scenes[s]->name << ": " << result.message
+                  << "; render p50 " << result.renderTime.percentile(50) << " us, max "
+                  << result.renderTime.max() << " us" << std::endl;
+    }
+    std::cout << results.size() - failed << "/" << results.size() << " scenes passed" << std::endl;
 
-                    LOGEvent(JoystickConnected);
-                    joyInfo.setJoystick(event.joystickConnect.joystickId);
-                    break;
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 
-                    LOGEvent(JoystickDisconnected);
-                    break;
+// What the input thread forwards to the render thread in --threaded mode
+struct InputMessage
+{
+    enum Kind
+    {
+        Event,
+        Log,
+        Text,
+    };
+
+    Kind kind = Event;
+    sf::Event event;
+    Action action = Action::None; // bound to the event, for Event
+    LogRecord record;
+    std::string text;        // UTF-8, for Text
+    sf::Int64 timestamp = 0; // when the input thread got it, in microseconds
+};
 
-                default:
-                    break;
-                }
-            lastType = event.type;
+// Logger for the window actions run on the input thread: the records are
+// forwarded to the render thread, which owns the real logger.
+class ForwardingLogger
+{
+public:
+    ForwardingLogger(MpscQueue<InputMessage>& queue, sf::Clock const& clock)
+        : queue(queue)
+        , clock(clock)
+    {
+    }
+
+    void log(LogRecord const& record)
+    {
+        InputMessage message;
+        message.kind = InputMessage::Log;
+        message.record = record;
+        push(std::move(message));
+    }
+
+    void log(sf::String const& text)
+    {
+        auto const utf8 = text.toUtf8();
+        InputMessage message;
+        message.kind = InputMessage::Text;
+        message.text.assign(utf8.begin(), utf8.end());
+        push(std::move(message));
+    }
+
+    // Block rather than lose anything when the render thread lags behind
+    void push(InputMessage&& message)
+    {
+        message.timestamp = clock.getElapsedTime().asMicroseconds();
+        while (!queue.push(std::move(message)))
+            std::this_thread::yield();
+    }
+
+private:
+    MpscQueue<InputMessage>& queue;
+    sf::Clock const& clock;
+};
 
-            // Actions
-            if (event.type == sf::Event::KeyReleased)
+// The main thread only drains OS events, timestamps them and forwards them to
+// a render thread which logs them, applies the display actions and draws, so
+// input is no longer sampled at the frame rate. SFML (and X11) require events
+// to be polled and the window to be changed on the thread that created it:
+// key bindings and window actions stay on the main thread, under a mutex
+// which the render thread holds while its context is active. The joystick
+// table shows what `sampler` publishes, if any. Returns once the window is
+// closed.
+void runThreaded(sf::RenderWindow& window, CursorCache& cursors, sf::Font const& font, GraphicLogger& logger,
+                 JoystickTable& joyInfo, JoystickSampler* sampler)
+{
+    MpscQueue<InputMessage> queue(8192);
+    std::mutex windowMutex;
+    std::atomic<bool> running{ true };
+    sf::Clock clock;
+    ForwardingLogger forwarder{ queue, clock };
+
+    // Written by the render thread, read once it is joined
+    Histogram queueDepth, queueLatency, presentLatency;
+
+    window.setActive(false);
+    std::thread renderer([&] {
+        auto cursorShape = makeCursorShape();
+        GridCache grid;
+        TextBatch sceneText;
+        bool altHeld = false;
+        bool shiftHeld = false;
+        sf::Vector2i mouse;
+
+        InputMessage message;
+        while (running)
+        {
+            queueDepth.record(queue.size());
+
+            sf::Int64 oldest = -1;
+            while (queue.pop(message))
             {
-                switch (event.key.code)
+                if (message.kind == InputMessage::Log)
                 {
-                default:
-                    break;
+                    logger.log(message.record);
+                    continue;
+                }
 
-                case sf::Keyboard::Num1:
-                    assert(cursor.loadFromSystem(sf::Cursor::Arrow));
-                    window.setMouseCursor(cursor);
-                    break;
+                if (message.kind == InputMessage::Text)
+                {
+                    logger.log(sf::String::fromUtf8(message.text.begin(), message.text.end()));
+                    continue;
+                }
 
-                case sf::Keyboard::Num2:
-                    assert(cursor.loadFromSystem(sf::Cursor::Cross));
-                    window.setMouseCursor(cursor);
-                    break;
+                auto const& event = message.event;
+                logEvent(logger, joyInfo, EventCoalescer::Entry{ event, {}, 1 });
+                applyDisplayAction(message.action);
 
-                case sf::Keyboard::Num3:
-                    assert(cursor.loadFromSystem(sf::Cursor::Hand));
-                    window.setMouseCursor(cursor);
-                    break;
+                // Track the keyboard and mouse state from events rather than
+                // querying the OS from this thread
+                if (event.type == sf::Event::KeyPressed || event.type == sf::Event::KeyReleased)
+                {
+                    bool const pressed = event.type == sf::Event::KeyPressed;
+                    if (event.key.code == sf::Keyboard::LAlt)
+                        altHeld = pressed;
+                    if (event.key.code == sf::Keyboard::LShift)
+                        shiftHeld = pressed;
+                }
+                else if (event.type == sf::Event::MouseMoved)
+                {
+                    mouse = { event.mouseMove.x, event.mouseMove.y };
+                }
 
-                case sf::Keyboard::Num4:
-                    assert(cursor.loadFromPixels(icon.getPixelsPtr(), icon.getSize(), icon.getSize() / 2u));
-                    window.setMouseCursor(cursor);
-                    break;
+                queueLatency.record(clock.getElapsedTime().asMicroseconds() - message.timestamp);
+                if (oldest < 0)
+                    oldest = message.timestamp;
+            }
 
-                case sf::Keyboard::Escape:
-                    window.close();
-                    break;
+            // SFML updates the joystick states while the main thread polls,
+            // under joystickMutex; a value read here may be one poll behind.
+            if (sampler)
+            {
+                joyInfo.update(sampler->snapshot());
+            }
+            else
+            {
+                std::lock_guard<std::mutex> lock(joystickMutex);
+                joyInfo.update();
+            }
 
-                case sf::Keyboard::F:
-                    goFullscreen(window);
-                    break;
+            std::lock_guard<std::mutex> lock(windowMutex);
+            if (!window.isOpen())
+                break;
 
-                case sf::Keyboard::N:
-                    goWindowed(window);
-                    break;
+            window.setActive(true);
+            cursorShape.setPosition(window.mapPixelToCoords(mouse, window.getView()));
 
-                case sf::Keyboard::G:
-                    grabbed = !grabbed;
-                    logger.log(grabbed ? "Grabbed" : "Released");
-                    window.setMouseCursorGrabbed(grabbed);
-                    break;
+            window.clear();
+            drawScene(window, font, sceneText, logger, joyInfo);
+            if (altHeld)
+                grid.draw(window, gridSize);
+            if (shiftHeld)
+                window.draw(cursorShape);
+            window.display();
+            window.setActive(false);
 
-                case sf::Keyboard::P:
-                    sf::Mouse::setPosition({ 100, 100 }, window);
-                    break;
+            if (oldest >= 0)
+                presentLatency.record(clock.getElapsedTime().asMicroseconds() - oldest);
+        }
+    });
 
-                case sf::Keyboard::Q:
-                    sf::Mouse::setPosition({ 100, 100 });
-                    break;
+    while (window.isOpen())
+    {
+        bool idle = true;
 
-                case sf::Keyboard::A:
-                    if (event.key.shift) window.setPosition({100, 100});
-                    else LOGXY(window.getPosition());
-                    break;
+        sf::Event event;
+        while (pollEvent(window, event))
+        {
+            idle = false;
 
-                case sf::Keyboard::B:
-                    LOGWidthHeight(sf::VideoMode::getDesktopMode());
-                    break;
+            InputMessage message;
+            message.event = event;
+            message.action = keyBindings.dispatch(event);
+            auto const action = message.action;
 
-                case sf::Keyboard::C:
-                    if (event.key.shift) {
-                        window.setSize({400, 600});
-                        sf::FloatRect visibleArea(0, 0, 400, 600);
-                        window.setView(sf::View(visibleArea));
-                    } else LOGXY(window.getSize());
-                    break;
+            // The pacing is only applied when a window is created in this
+            // mode, and the render thread must not write it
+            if (action == Action::NextPacing)
+            {
+                message.action = Action::None;
+                forwarder.log(LogRecord::text("Pacing cannot be changed with --threaded"));
+            }
+            forwarder.push(std::move(message));
 
-                case sf::Keyboard::J:
-                    displayJoystickTable = !displayJoystickTable;
-                    break;
+            if (isWindowAction(action))
+            {
+                std::lock_guard<std::mutex> lock(windowMutex);
+                applyWindowAction(forwarder, window, cursors, action);
+                window.setActive(false); // a new window activates its context here
+            }
+        }
+
+        if (keyBindings.reload())
+            forwarder.log(LogRecord::text("Key bindings reloaded"));
+
+        if (idle)
+            sf::sleep(sf::milliseconds(1));
+    }
+
+    running = false;
+    renderer.join();
+
+    std::cout << "Threaded input:\n"
+              << "\tqueue depth: p50 " << queueDepth.percentile(50) << ", max " << queueDepth.max() << "\n"
+              << "\tqueue latency: p50 " << queueLatency.percentile(50) << " us, p99 "
+              << queueLatency.percentile(99) << " us, max " << queueLatency.max() << " us\n"
+              << "\tinput to present: p50 " << presentLatency.percentile(50) << " us, p99 "
+              << presentLatency.percentile(99) << " us, max " << presentLatency.max() << " us" << std::endl;
+}
+
+// A window, or an offscreen texture, of the stress test, fed synthetic events
+// stamped with the time they were sent so that the latency of their handling
+// includes the time spent waiting for the other windows.
+struct StressEvent
+{
+    sf::Event event;
+    sf::Int64 timestamp = 0; // in microseconds
+};
+
+struct StressTarget
+{
+    std::unique_ptr<sf::RenderWindow> window;
+    std::unique_ptr<sf::RenderTexture> texture;
+    SpscQueue<StressEvent> queue{ 4096 };
+    std::uint64_t sent = 0;    // written by the feeder only
+    std::uint64_t dropped = 0; // idem
+    Histogram frameTime;
+    Histogram eventLatency;
+    Histogram activation; // time to make the context current
+
+    sf::RenderTarget& target() { return window ? static_cast<sf::RenderTarget&>(*window) : *texture; }
+    bool setActive(bool active) { return window ? window->setActive(active) : texture->setActive(active); }
+};
+
+// Voluntary and involuntary context switches of the process so far
+long contextSwitches()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+// Handle the pending events of `target` and draw it once
+void drawStressFrame(StressTarget& stress, GraphicLogger& logger, sf::Clock const& clock)
+{
+    sf::Clock frameClock;
+    stress.setActive(true);
+    stress.activation.record(frameClock.getElapsedTime().asMicroseconds());
+
+    StressEvent message;
+    while (stress.queue.pop(message))
+    {
+        logger.log(LogRecord::pair("event.mouseMove", message.event.mouseMove.x, message.event.mouseMove.y));
+        stress.eventLatency.record(clock.getElapsedTime().asMicroseconds() - message.timestamp);
+    }
+
+    auto& target = stress.target();
+    target.clear();
+    target.draw(logger);
+    drawBorder(target);
+    if (stress.window)
+        stress.window->display();
+    else
+        stress.texture->display();
+    stress.frameTime.record(frameClock.getElapsedTime().asMicroseconds());
+}
+
+// Open `count` windows (or offscreen textures) and draw them all, either in
+// turn from the main thread, switching the active context for each of them,
+// or each from its own thread. In both cases, windows are polled from the main
+// thread as SFML requires and a feeder thread sends `rate` mouse events per
+// second to each of them. The frame rate is not limited. Returns false if the
+// targets or the fonts cannot be created.
+bool runStressModel(bool threaded, std::size_t count, bool offscreen, sf::Time duration, unsigned int rate,
+                    MappedFile const& fontFile)
+{
+    // sf::Font is not thread-safe: one per renderer thread, over the same file
+    std::vector<sf::Font> fonts(threaded ? count : 1);
+    for (auto& font : fonts)
+        if (!font.loadFromMemory(fontFile.data(), fontFile.size()))
+            return false;
+
+    std::vector<std::unique_ptr<StressTarget>> targets;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto stress = std::make_unique<StressTarget>();
+        if (offscreen)
+        {
+            stress->texture = std::make_unique<sf::RenderTexture>();
+            if (!stress->texture->create(320, 240))
+                return false;
+        }
+        else
+        {
+            auto const title = "Stress " + std::to_string(i);
+            stress->window = std::make_unique<sf::RenderWindow>(sf::VideoMode(320, 240), title,
+                                                                sf::Style::Titlebar | sf::Style::Close);
+            auto const offset = static_cast<int>(i % 16);
+            stress->window->setPosition({ 40 + 40 * offset, 40 + 30 * offset });
+            stress->window->setVerticalSyncEnabled(false);
+        }
+        stress->setActive(false);
+        targets.push_back(std::move(stress));
+    }
 
+    sf::Clock clock;
+    std::atomic<bool> running{ true };
+
+    std::thread feeder([&] {
+        auto const events = generateEvents("mouse", 4096);
+        std::size_t next = 0;
+        double due = 0;
+        while (running)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            auto const now = clock.getElapsedTime();
+            for (; due < now.asSeconds() * rate; ++due)
+            {
+                auto const& event = events[next++ % events.size()];
+                for (auto& stress : targets)
+                {
+                    ++stress->sent;
+                    if (!stress->queue.push({ event, now.asMicroseconds() }))
+                        ++stress->dropped;
                 }
             }
         }
+    });
 
+    // Poll every window; false once one of them is closed
+    auto poll = [&] {
+        sf::Event event;
+        for (auto& stress : targets)
+            while (stress->window && stress->window->pollEvent(event))
+                if (event.type == sf::Event::Closed ||
+                    (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::Escape))
+                    return false;
+        return true;
+    };
+
+    auto const switchesBefore = contextSwitches();
+    if (threaded)
+    {
+        std::vector<std::thread> renderers;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            renderers.emplace_back([&, target = targets[i].get(), &font = fonts[i]] {
+                GraphicLogger logger{ font, 14, 12 };
+                logger.setPosition(25, 25);
+                while (running)
+                    drawStressFrame(*target, logger, clock);
+                target->setActive(false);
+            });
+        }
 
-        joyInfo.update();
+        while (running && clock.getElapsedTime() < duration)
+        {
+            running = poll();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        running = false;
+        for (auto& renderer : renderers)
+            renderer.join();
+    }
+    else
+    {
+        std::vector<std::unique_ptr<GraphicLogger>> loggers;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            loggers.push_back(std::make_unique<GraphicLogger>(fonts.front(), 14, 12));
+            loggers.back()->setPosition(25, 25);
+        }
+
+        while (running && clock.getElapsedTime() < duration)
+        {
+            running = poll();
+            for (std::size_t i = 0; i < count; ++i)
+                drawStressFrame(*targets[i], *loggers[i], clock);
+        }
+        running = false;
+    }
+    auto const switches = contextSwitches() - switchesBefore;
+    auto const elapsed = clock.getElapsedTime().asSeconds();
+    feeder.join();
+
+    std::cout << "Stress " << (threaded ? "thread per window" : "round-robin") << ", " << count
+              << (offscreen ? " offscreen textures" : " windows") << ", " << elapsed << " s:\n";
+    std::uint64_t frames = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto const& stress = *targets[i];
+        frames += stress.frameTime.count();
+        std::cout << "\t" << i << ": " << stress.frameTime.count() << " frames, frame p50 "
+                  << stress.frameTime.percentile(50) << " p99 " << stress.frameTime.percentile(99)
+                  << " us, event latency p50 " << stress.eventLatency.percentile(50) << " p99 "
+                  << stress.eventLatency.percentile(99) << " us, context activation p50 "
+                  << stress.activation.percentile(50) << " p99 " << stress.activation.percentile(99) << " us, "
+                  << stress.dropped << "/" << stress.sent << " events dropped\n";
+    }
+    std::cout << "\ttotal: " << frames / elapsed << " frames/s, " << switches << " OS context switches ("
+              << (frames ? static_cast<double>(switches) / frames : 0) << " per frame)" << std::endl;
+
+    for (auto& stress : targets)
+        if (stress->window)
+            stress->window->close();
+    return true;
+}
+
+// --stress-model=round-robin, threads or both (one after the other)
+int runStress(int argc, char const** argv)
+{
+    auto const count = std::stoul(optionValue(argc, argv, "--stress-windows", "4"));
+    auto const model = optionValue(argc, argv, "--stress-model", "both");
+    auto const duration = sf::seconds(std::stof(optionValue(argc, argv, "--stress-seconds", "5")));
+    auto const rate = std::stoul(optionValue(argc, argv, "--stress-rate", "1000"));
+    bool const offscreen = hasOption(argc, argv, "--stress-offscreen");
+
+    if (model != "round-robin" && model != "threads" && model != "both")
+    {
+        std::cerr << "Unknown stress model " << model << ", expected round-robin, threads or both" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto const fontPath = resourcePath() + interfaceFontFile;
+    MappedFile fontFile;
+    if (!fontFile.open(fontPath))
+    {
+        std::cerr << "Cannot open font " << fontPath << ": " << std::strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (model != "threads" && !runStressModel(false, count, offscreen, duration, rate, fontFile))
+        return EXIT_FAILURE;
+    if (model != "round-robin" && !runStressModel(true, count, offscreen, duration, rate, fontFile))
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char const** argv)
+{
+    std::setlocale(LC_ALL, "");
+    fastModeSwitch = hasOption(argc, argv, "--fast-mode-switch");
+
+    if (hasOption(argc, argv, "--bench-logger"))
+        return benchmarkLogger();
+
+    if (hasOption(argc, argv, "--bench-text"))
+        return benchmarkText(argc, argv);
+
+    if (hasOption(argc, argv, "--bench-events"))
+        return benchmarkEvents(argc, argv);
+
+    if (hasOption(argc, argv, "--bench-cursors"))
+        return benchmarkCursors(argc, argv);
+
+    if (hasOption(argc, argv, "--bench-modes"))
+        return benchmarkModes(argc, argv);
+
+    if (hasOption(argc, argv, "--bench-input"))
+        return benchmarkInput(argc, argv);
+
+    if (hasOption(argc, argv, "--headless"))
+        return runHeadless(argc, argv);
+
+    auto const goldenDirectory = optionValue(argc, argv, "--regress", "");
+    if (!goldenDirectory.empty())
+        return runRegression(goldenDirectory, argc, argv);
+
+    if (hasOption(argc, argv, "--stress"))
+        return runStress(argc, argv);
+
+    auto const replayPath = optionValue(argc, argv, "--replay", "");
+    if (!replayPath.empty())
+        return replayTrace(replayPath, !hasOption(argc, argv, "--replay-fast"), makeCoalescer(argc, argv));
+
+    // The render thread of --threaded only logs and draws the logger, the
+    // joystick table, the grid and the cursor
+    if (hasOption(argc, argv, "--threaded"))
+    {
+        for (auto option : { "--record", "--history", "--coalesce", "--stats", "--always-redraw" })
+        {
+            if (hasOption(argc, argv, option) || !optionValue(argc, argv, option, "").empty())
+            {
+                std::cerr << option << " is not supported with --threaded" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    // Record events if asked to
+    TraceWriter recorder;
+    auto const recordPath = optionValue(argc, argv, "--record", "");
+    if (!recordPath.empty() && !recorder.open(recordPath))
+        return EXIT_FAILURE;
+    sf::Clock recordClock;
+
+    auto const pacingName = optionValue(argc, argv, "--pacing", "fixed");
+    auto const requestedPacing = string2pacing(pacingName);
+    if (!requestedPacing)
+    {
+        std::cerr << "Unknown pacing " << pacingName << ", expected fixed, vsync, event or uncapped" << std::endl;
+        return EXIT_FAILURE;
+    }
+    pacing = *requestedPacing;
+
+    // Decode the assets needed for the first frame while the window is created
+    ResourceManager resources;
+    resources.preload("icon.png");
+    resources.preload(interfaceFontFile);
+
+    printVideoModes();
+
+    // Create the main window
+    sf::RenderWindow window;
+    goWindowed(window);
+    resources.mark("window created");
+
+    // Set the Icon
+    auto const* iconImage = resources.image("icon.png");
+    if (!iconImage)
+        return EXIT_FAILURE;
+    auto const& icon = *iconImage;
+
+    window.setIcon(icon.getSize().x, icon.getSize().y, icon.getPixelsPtr());
+
+    // Create the cursors once, switching between them is then free
+    CursorCache cursors{ icon };
+    cursors.preload();
+    resources.mark("cursors created");
+
+    // Load our font
+    FontCache fonts;
+    auto const* interfaceFont = loadInterfaceFont(fonts, resources, argc, argv);
+    if (!interfaceFont)
+        return EXIT_FAILURE;
+    auto const& font = *interfaceFont;
+    resources.mark("glyphs prewarmed");
+    std::cout << "Glyph atlases: " << fonts.atlasBytes() / 1024 << " KiB" << std::endl;
+
+    auto cursorShape = makeCursorShape();
+    GridCache grid;
+    TextBatch sceneText;
+
+    // Create a logger, echoing to stdout asynchronously
+    StdoutSink::Policy sinkPolicy;
+    sinkPolicy.interval = sf::milliseconds(std::stoi(optionValue(argc, argv, "--log-interval", "100")));
+    sinkPolicy.flushSize = std::stoul(optionValue(argc, argv, "--log-flush-size", "65536"));
+    sinkPolicy.capacity = std::stoul(optionValue(argc, argv, "--log-capacity", "4096"));
+    sinkPolicy.overflow = hasOption(argc, argv, "--log-block") ? StdoutSink::Overflow::Block
+                                                               : StdoutSink::Overflow::Drop;
+    StdoutSink sink{ sinkPolicy };
+
+    GraphicLogger logger{ font, 20, 20 };
+    logger.setPosition(50, 50);
+    logger.setSink(&sink);
+    JoystickTable joyInfo{ font, 20 };
+    joyInfo.setPosition(50, 50);
+
+    // Keep every log in a history that can be scrolled back and searched
+    LogHistory history;
+    std::unique_ptr<HistoryView> historyView;
+    auto const historyPath = optionValue(argc, argv, "--history", "");
+    if (!historyPath.empty())
+    {
+        if (!history.open(historyPath))
+            return EXIT_FAILURE;
+        logger.setHistory(&history);
+        historyView = std::make_unique<HistoryView>(history, font, 20, 20);
+        historyView->setPosition(50, 50);
+    }
+
+    InputPanel inputPanel{ font, 20, 19, 56 };
+    inputPanel.setPosition(50, 50);
+
+    // Sample the joysticks from a thread, or virtual ones, if asked to
+    std::unique_ptr<JoystickSampler> joystickSampler;
+    auto const joystickRate = std::stoul(optionValue(argc, argv, "--joystick-rate", "0"));
+    auto const mockJoysticks = std::stoul(optionValue(argc, argv, "--joystick-mock", "0"));
+    if (joystickRate > 0 || mockJoysticks > 0)
+    {
+        std::unique_ptr<JoystickBackend> backend;
+        if (mockJoysticks > 0)
+            backend = std::make_unique<MockJoystickBackend>(mockJoysticks);
+        else
+            backend = std::make_unique<SfmlJoystickBackend>();
+        auto const rate = joystickRate > 0 ? static_cast<unsigned int>(joystickRate) : 1000u;
+        joystickSampler = std::make_unique<JoystickSampler>(std::move(backend), rate);
+    }
+
+    FrameStats stats;
+    StatsOverlay statsOverlay{ font, 14 };
+
+    auto coalescer = makeCoalescer(argc, argv);
+    std::uint64_t dispatchedEvents = 0;
+
+    auto const bindingsPath = optionValue(argc, argv, "--bindings", "");
+    if (!bindingsPath.empty() && !keyBindings.load(bindingsPath))
+        return EXIT_FAILURE;
+
+    DamageTracker damage{ !hasOption(argc, argv, "--always-redraw") };
+    sf::Clock frameClock;
+    bool idle = false;
+    bool firstFrame = true;
+
+    // Sum up the current pacing policy when leaving it, then start over
+    auto appliedPacing = pacing;
+    sf::Clock pacingClock;
+    auto pacingCpuTime = cpuTime();
+    auto const reportPacing = [&] {
+        auto const wall = pacingClock.restart();
+        auto const cpu = cpuTime() - pacingCpuTime;
+        pacingCpuTime += cpu;
+        std::cout << "Pacing " << pacing2string(appliedPacing) << ": " << stats[FrameStats::Frame].count()
+                  << " frames in " << wall.asSeconds() << " s, CPU " << 100 * cpu.asSeconds() / wall.asSeconds()
+                  << "%, frame p50 " << stats[FrameStats::Frame].percentile(50) << " us, event latency p99 "
+                  << stats[FrameStats::EventLatency].percentile(99) << " us" << std::endl;
+    };
+
+    if (hasOption(argc, argv, "--threaded"))
+    {
+        resources.report(std::cout);
+        runThreaded(window, cursors, font, logger, joyInfo, joystickSampler.get());
+    }
+
+    auto const receive = [&](sf::Event const& event) {
+        if (recorder.isOpen())
+            recorder.append(event, recordClock.getElapsedTime());
+
+        coalescer.push(event);
+    };
+
+    // Start the game loop
+    while (window.isOpen())
+    {
+        if (pacing != appliedPacing)
+        {
+            reportPacing();
+            stats.reset();
+            appliedPacing = pacing;
+            applyPacing(window);
+        }
+
+        frameClock.restart();
+        stats.beginFrame();
 
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::LSystem) ||
-            sf::Keyboard::isKeyPressed(sf::Keyboard::RSystem)) {
-            bool v = sf::Keyboard::isKeyPressed(sf::Keyboard::V);
-            bool c = sf::Keyboard::isKeyPressed(sf::Keyboard::C);
+        // Process events, merging motion bursts
+        sf::Event event;
+        if (idle && pacing == Pacing::EventDriven)
+        {
+            if (waitEvent(window, event, sf::milliseconds(100)))
+                receive(event);
+            stats.endPhase(FrameStats::Idle);
+        }
+        while (pollEvent(window, event))
+            receive(event);
 
-            if (v && c) { /* no action */ }
-            else if (v) { logger.log(sf::Clipboard::getString()); }
-            else if (c) { sf::Clipboard::setString(L"∆ß∂ƒ¬qø");   }
+        for (auto const& entry : coalescer.events())
+        {
+            auto const action = handleEvent(logger, joyInfo, &window, cursors, entry);
+            if (historyView && action == Action::None)
+                historyView->handleEvent(entry.event);
+            if (textInput)
+                inputPanel.handleEvent(entry.event);
+            applyViewAction(historyView.get(), inputPanel, action);
+            stats.eventHandled();
         }
+        dispatchedEvents += coalescer.events().size();
+        coalescer.clear();
+        stats.endPhase(FrameStats::EventDrain);
+
+        if (joystickSampler)
+            joyInfo.update(joystickSampler->snapshot());
+        else
+            joyInfo.update();
+        stats.endPhase(FrameStats::JoystickUpdate);
+
+        if (keyBindings.reload())
+            logger.log(LogRecord::text("Key bindings reloaded"));
+
+        if (historyView)
+            historyView->update();
+        if (textInput)
+            inputPanel.update();
 
         auto position = window.mapPixelToCoords(sf::Mouse::getPosition(window), window.getView());
         cursorShape.setPosition(position);
 
+        if (displayStats)
+            statsOverlay.update(stats, "pacing: " + std::string(pacing2string(pacing)));
+
+        // Skip the frame if it would look like the last one
+        DamageTracker::State scene;
+        scene.joystickTable = displayJoystickTable;
+        scene.textInput = textInput;
+        scene.history = historyView && historyView->isActive();
+        scene.content = scene.joystickTable ? joyInfo.getRevision()
+                        : scene.textInput   ? inputPanel.getRevision()
+                        : scene.history     ? historyView->getRevision()
+                                            : logger.getRevision();
+        scene.windowCount = windowCount;
+        scene.size = window.getSize();
+        scene.grid = sf::Keyboard::isKeyPressed(sf::Keyboard::LAlt);
+        scene.gridSize = gridSize;
+        scene.cursor = sf::Keyboard::isKeyPressed(sf::Keyboard::LShift);
+        scene.cursorPosition = scene.cursor ? position : sf::Vector2f();
+        scene.overlay = displayStats ? statsOverlay.getRevision() : 0;
+        idle = !damage.isDamaged(scene);
+        if (idle)
+        {
+            sf::sleep(idleFrameTime() - frameClock.getElapsedTime());
+            stats.endPhase(FrameStats::Idle);
+            continue;
+        }
+
         // Clear screen
         window.clear();
 
-        // Draw the logger/joystick table
-        if (displayJoystickTable)
-            window.draw(joyInfo);
-        else
-            window.draw(logger);
-
-        drawWindowCount(window, font);
-        drawBorder(window);
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::LAlt))
-            drawGrid(window, 50);
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::LShift))
+        drawScene(window, font, sceneText, logger, joyInfo, historyView.get(), &inputPanel);
+        if (scene.grid)
+            grid.draw(window, gridSize);
+        if (scene.cursor)
             window.draw(cursorShape);
+        if (displayStats)
+        {
+            statsOverlay.setPosition(window.getSize().x - statsOverlay.getSize().x - 30, 30);
+            window.draw(statsOverlay);
+        }
+        stats.endPhase(FrameStats::Draw);
 
         // Update the window
         window.display();
+        stats.endPhase(FrameStats::Display);
+        stats.endFrame();
+        modeSwitches.presented();
+
+        if (firstFrame)
+        {
+            resources.mark("first frame");
+            resources.report(std::cout);
+            firstFrame = false;
+        }
     }
+    reportPacing();
+
+    auto const statsPath = optionValue(argc, argv, "--stats", "");
+    if (!statsPath.empty() && !stats.save(statsPath))
+        std::cerr << "Cannot write timing statistics to " << statsPath << std::endl;
+
+    std::cout << "Coalescing: " << coalescer.receivedEvents() << " events received, " << dispatchedEvents
+              << " dispatched" << std::endl;
+    std::cout << "Damage tracking: " << damage.skippedFrames() << " idle frames skipped" << std::endl;
+    if (modeSwitches.count() > 0)
+        modeSwitches.report(std::cout);
+    if (joystickSampler)
+        std::cout << "Joystick sampler: " << joystickSampler->snapshot().sampleRate << " samples/s" << std::endl;
+    std::cout << "Glyph atlases: " << fonts.atlasBytes() / 1024 << " KiB" << std::endl;
+    std::cout << "Log sink: " << sink.droppedLines() << " dropped lines, queue high-water mark "
+              << sink.queueHighWaterMark() << "/" << sink.queueCapacity() << std::endl;
 
     return EXIT_SUCCESS;
 }